@@ -0,0 +1,482 @@
+// Pull in the whole game, so the benchmarks time the real handlers and render code
+#define FIA_NO_MAIN
+#include <main.c>
+#include <simulation.h>
+
+#define MAX_BENCHMARKS 16
+#define MAX_REPETITIONS 101
+#define DEFAULT_REPETITIONS 21
+#define WARMUP_RUNS 3
+// Every timed run is made long enough to drown out the timer resolution
+#define MIN_RUN_MS 20
+#define POSITION_POOL 1024
+#define BENCHMARK_SEED 0x2545F491
+
+typedef struct Benchmark Benchmark;
+typedef struct BenchmarkResult BenchmarkResult;
+
+/*
+ * One measured operation. run performs it iterations times in a row and is
+ * timed as a whole, the harness picks iterations so a run takes at least
+ * MIN_RUN_MS.
+ */
+struct Benchmark
+{
+	const char* name;
+	void(*run)(int iterations);
+};
+
+// Time per operation in nanoseconds
+struct BenchmarkResult
+{
+	char name[64];
+	double median;
+	double mad;
+	int repetitions;
+	int iterations;
+};
+
+/* Funcion declarations */
+void runApplyMove(int iterations);
+void runGenerateMoves(int iterations);
+void runMoveResolution(int iterations);
+void runMoveInputToText(int iterations);
+void runCastDie(int iterations);
+void runSimulateGame(int iterations);
+void runRenderedText(int iterations);
+void runTextureFromFile(int iterations);
+void runRenderGame(int iterations);
+
+int setupBenchmarks();
+void measure(const Benchmark* benchmark, int repetitions, BenchmarkResult* result);
+double timeRun(const Benchmark* benchmark, int iterations);
+int compareDoubles(const void* a, const void* b);
+int loadResults(const char* path, BenchmarkResult* results, int maxResults);
+int saveResults(FILE* file, const BenchmarkResult* results, int count);
+int compareResults(const BenchmarkResult* results, int count, const BenchmarkResult* baseline, int baselineCount, double threshold);
+
+/* Benchmarks */
+const Benchmark BENCHMARKS[] =
+{
+	{ "rules/applyMove", &runApplyMove },
+	{ "rules/generateMoves", &runGenerateMoves },
+	{ "game/moveResolution", &runMoveResolution },
+	{ "game/moveInputToText", &runMoveInputToText },
+	{ "game/castDie", &runCastDie },
+	{ "simulation/fullGame", &runSimulateGame },
+	{ "texture/loadFromRenderedText", &runRenderedText },
+	{ "texture/loadTextureFromFile", &runTextureFromFile },
+	{ "render/renderGame", &runRenderGame }
+};
+const int BENCHMARK_COUNT = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+// Mid game positions with a die value that moves at least one unit, recorded from self-play
+Position pool[POSITION_POOL];
+int poolDice[POSITION_POOL];
+int poolUnits[POSITION_POOL];
+Texture scratchTexture;
+
+// Keeps the optimizer from dropping work whose result is never used
+volatile int benchmarkSink;
+
+/* Function definitions */
+int main(int argc, char* args[])
+{
+	const char* outPath = "benchmark.csv";
+	const char* baselinePath = NULL;
+	const char* assets = "..\\Game";
+	const char* filter = NULL;
+	int repetitions = DEFAULT_REPETITIONS;
+	double threshold = 0.05;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--out") == 0 && i + 1 < argc)
+		{
+			outPath = args[++i];
+		}
+		else if (strcmp(args[i], "--baseline") == 0 && i + 1 < argc)
+		{
+			baselinePath = args[++i];
+		}
+		else if (strcmp(args[i], "--threshold") == 0 && i + 1 < argc)
+		{
+			threshold = atof(args[++i]) / 100.0;
+		}
+		else if (strcmp(args[i], "--repetitions") == 0 && i + 1 < argc)
+		{
+			repetitions = SDL_max(3, SDL_min(MAX_REPETITIONS, atoi(args[++i])));
+		}
+		else if (strcmp(args[i], "--filter") == 0 && i + 1 < argc)
+		{
+			filter = args[++i];
+		}
+		else if (strcmp(args[i], "--assets") == 0 && i + 1 < argc)
+		{
+			assets = args[++i];
+		}
+		else
+		{
+			printf("Usage: %s [--out results.csv] [--baseline baseline.csv] [--threshold percent] [--repetitions n] [--filter name] [--assets game directory]\n", args[0]);
+			return 1;
+		}
+	}
+
+	// Both files are opened before moving to the asset directory, so their paths stay relative to where we were started
+	BenchmarkResult baseline[MAX_BENCHMARKS];
+	int baselineCount = 0;
+	if (baselinePath != NULL && (baselineCount = loadResults(baselinePath, baseline, MAX_BENCHMARKS)) <= 0)
+	{
+		printf("Unable to read baseline %s!\n", baselinePath);
+		return 1;
+	}
+
+	FILE* out = fopen(outPath, "w");
+	if (out == NULL)
+	{
+		printf("Unable to write results to %s!\n", outPath);
+		return 1;
+	}
+
+	if (!SetCurrentDirectoryA(assets))
+	{
+		printf("Unable to find the game assets in %s!\n", assets);
+		fclose(out);
+		return 1;
+	}
+
+	int success = 0;
+	if (!init())
+	{
+		printf("Failed to initialize!\n");
+	}
+	else if (!setupBenchmarks())
+	{
+		printf("Failed to set up the benchmarks!\n");
+	}
+	else
+	{
+		BenchmarkResult results[MAX_BENCHMARKS];
+		int count = 0;
+
+		printf("%-30s %14s %12s %6s %10s\n", "benchmark", "median ns/op", "MAD ns/op", "reps", "iterations");
+		for (int i = 0; i < BENCHMARK_COUNT; i++)
+		{
+			if (filter != NULL && strstr(BENCHMARKS[i].name, filter) == NULL)
+			{
+				continue;
+			}
+
+			measure(&BENCHMARKS[i], repetitions, &results[count]);
+			printf("%-30s %14.1f %12.1f %6d %10d\n", results[count].name, results[count].median, results[count].mad, results[count].repetitions, results[count].iterations);
+			count++;
+		}
+
+		success = saveResults(out, results, count);
+		if (success && baselinePath != NULL)
+		{
+			success = compareResults(results, count, baseline, baselineCount, threshold);
+		}
+	}
+
+	fclose(out);
+	freeTexture(&scratchTexture);
+	close();
+
+	// A regression fails the run, so a build script can stop on it
+	return success ? 0 : 1;
+}
+
+int setupBenchmarks()
+{
+	/* Load global font */
+	font = TTF_OpenFont("font.ttf", 28);
+	if (font == NULL)
+	{
+		printf("Failed to load font! SDL_ttf Error: %s\n", TTF_GetError());
+		return 0;
+	}
+
+	// The game scene on the standard board, with every seat played by hand
+	standardBoard(&boardDescription, BOARD_WIDTH, BOARD_HEIGHT);
+	if (!pushScene(&gameScene))
+	{
+		printf("Failed to load game!\n");
+		return 0;
+	}
+
+	// Same random stream on every run, so runs are comparable
+	srand(BENCHMARK_SEED);
+
+	// Record positions from self-play, keeping only those where the die allows a move
+	Uint32 rng = BENCHMARK_SEED;
+	Position pos;
+	resetPosition(&pos);
+	for (int count = 0; count < POSITION_POOL;)
+	{
+		int dieValue = rollDie(&rng, 6);
+		int units[MAX_TEAM_SIZE];
+		int moveCount = generateMoves(rules, &pos, dieValue, units);
+		if (moveCount > 0)
+		{
+			pool[count] = pos;
+			poolDice[count] = dieValue;
+			poolUnits[count] = units[nextRandom(&rng) % moveCount];
+			count++;
+		}
+
+		playTurn(rules, &pos, &aiWeights, &rng, 0.1f, NULL);
+		if (winningTeam(rules, &pos) >= 0)
+		{
+			resetPosition(&pos);
+		}
+	}
+
+	return 1;
+}
+
+void measure(const Benchmark* benchmark, int repetitions, BenchmarkResult* result)
+{
+	// Grow the run until it is long enough to time, this doubles as warming caches and the driver up
+	int iterations = 1;
+	while (timeRun(benchmark, iterations) < MIN_RUN_MS * 1e6 && iterations < (1 << 24))
+	{
+		iterations *= 2;
+	}
+
+	for (int i = 0; i < WARMUP_RUNS; i++)
+	{
+		timeRun(benchmark, iterations);
+	}
+
+	double samples[MAX_REPETITIONS];
+	for (int i = 0; i < repetitions; i++)
+	{
+		samples[i] = timeRun(benchmark, iterations) / iterations;
+	}
+
+	// Median and median absolute deviation, neither is thrown off by a run the OS interrupted
+	qsort(samples, repetitions, sizeof(double), compareDoubles);
+	double median = samples[repetitions / 2];
+	for (int i = 0; i < repetitions; i++)
+	{
+		samples[i] = fabs(samples[i] - median);
+	}
+	qsort(samples, repetitions, sizeof(double), compareDoubles);
+
+	SDL_strlcpy(result->name, benchmark->name, sizeof(result->name));
+	result->median = median;
+	result->mad = samples[repetitions / 2];
+	result->repetitions = repetitions;
+	result->iterations = iterations;
+}
+
+double timeRun(const Benchmark* benchmark, int iterations)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	benchmark->run(iterations);
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	return (double)(end - start) * 1e9 / SDL_GetPerformanceFrequency();
+}
+
+int compareDoubles(const void* a, const void* b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+int loadResults(const char* path, BenchmarkResult* results, int maxResults)
+{
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return -1;
+	}
+
+	// Same format saveResults writes, the header line does not parse and is skipped
+	char line[256];
+	int count = 0;
+	while (count < maxResults && fgets(line, sizeof(line), file) != NULL)
+	{
+		BenchmarkResult* result = &results[count];
+		if (sscanf(line, "%63[^,],%lf,%lf,%d,%d", result->name, &result->median, &result->mad, &result->repetitions, &result->iterations) == 5)
+		{
+			count++;
+		}
+	}
+
+	fclose(file);
+	return count;
+}
+
+int saveResults(FILE* file, const BenchmarkResult* results, int count)
+{
+	fprintf(file, "name,median_ns,mad_ns,repetitions,iterations\n");
+	for (int i = 0; i < count; i++)
+	{
+		fprintf(file, "%s,%.2f,%.2f,%d,%d\n", results[i].name, results[i].median, results[i].mad, results[i].repetitions, results[i].iterations);
+	}
+
+	return !ferror(file);
+}
+
+int compareResults(const BenchmarkResult* results, int count, const BenchmarkResult* baseline, int baselineCount, double threshold)
+{
+	int regressions = 0;
+
+	printf("\n%-30s %14s %14s %9s\n", "benchmark", "baseline ns", "current ns", "change");
+	for (int i = 0; i < count; i++)
+	{
+		const BenchmarkResult* old = NULL;
+		for (int j = 0; j < baselineCount && old == NULL; j++)
+		{
+			old = strcmp(baseline[j].name, results[i].name) == 0 ? &baseline[j] : NULL;
+		}
+
+		if (old == NULL)
+		{
+			printf("%-30s %14s %14.1f %9s\n", results[i].name, "-", results[i].median, "new");
+			continue;
+		}
+
+		// Only a slowdown beyond the threshold that also stands out of the noise of both runs counts
+		double change = (results[i].median - old->median) / old->median;
+		int regressed = change > threshold && results[i].median - old->median > 3.0 * SDL_max(results[i].mad, old->mad);
+		regressions += regressed;
+
+		printf("%-30s %14.1f %14.1f %+8.1f%%%s\n", results[i].name, old->median, results[i].median, change * 100.0, regressed ? "  REGRESSION" : "");
+	}
+
+	if (regressions > 0)
+	{
+		printf("%d benchmark(s) regressed by more than %.1f%%!\n", regressions, threshold * 100.0);
+	}
+
+	return regressions == 0;
+}
+
+/***** BENCHMARKS *****/
+void runApplyMove(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		int k = i % POSITION_POOL;
+		Position pos = pool[k];
+		benchmarkSink += applyMove(rules, &pos, poolUnits[k], poolDice[k], NULL);
+	}
+}
+
+void runGenerateMoves(int iterations)
+{
+	int units[MAX_TEAM_SIZE];
+	for (int i = 0; i < iterations; i++)
+	{
+		int k = i % POSITION_POOL;
+		benchmarkSink += generateMoves(rules, &pool[k], poolDice[k], units);
+	}
+}
+
+void runMoveResolution(int iterations)
+{
+	// The move and the board update the game makes for it, without the text of the next phase
+	for (int i = 0; i < iterations; i++)
+	{
+		int k = i % POSITION_POOL;
+		Position pos = pool[k];
+		MoveResult result;
+		benchmarkSink += applyMove(rules, &pos, poolUnits[k], poolDice[k], &result);
+		syncBoardView(&board, &pos);
+	}
+}
+
+void runMoveInputToText(int iterations)
+{
+	// Enter in the move phase, exactly as the player would press it, up to the rendered game message
+	SDL_Event e = { 0 };
+	e.type = SDL_KEYDOWN;
+	e.key.keysym.sym = SDLK_RETURN;
+
+	for (int i = 0; i < iterations; i++)
+	{
+		int k = i % POSITION_POOL;
+		position = pool[k];
+		turn = position.turn;
+		die->currentValue = poolDice[k];
+		selectedUnitIndex = poolUnits[k] % rules->teamSize;
+		phase = MOVE;
+		pauseInput = 0;
+
+		benchmarkSink += handleGameEvent(&e);
+	}
+}
+
+void runCastDie(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		castDie(die);
+		benchmarkSink += die->currentValue;
+	}
+}
+
+void runSimulateGame(int iterations)
+{
+	// Game i always plays the same seed, so every run plays the same games
+	for (int i = 0; i < iterations; i++)
+	{
+		Uint32 rng = BENCHMARK_SEED + i;
+		Position pos;
+		resetPosition(&pos);
+
+		int turns = 0;
+		while (winningTeam(rules, &pos) < 0 && turns < MAX_TURNS)
+		{
+			playTurn(rules, &pos, &aiWeights, &rng, 0, NULL);
+			turns++;
+		}
+
+		benchmarkSink += turns;
+	}
+}
+
+void runRenderedText(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		SDL_snprintf(gameMsg, GAME_MSG_SIZE, "Team %s's turn. Press Space to roll the die.", TEAM_NAMES[i % STANDARD_TEAMS]);
+		benchmarkSink += loadFromRenderedText(&scratchTexture, renderer, font, gameMsg, (SDL_Color){ 0, 0, 0 });
+	}
+}
+
+void runTextureFromFile(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		benchmarkSink += loadTextureFromFile(&scratchTexture, renderer, "players.png");
+	}
+}
+
+void runRenderGame(int iterations)
+{
+	// A busy mid game board with the die showing
+	position = pool[POSITION_POOL - 1];
+	turn = position.turn;
+	die->currentValue = poolDice[POSITION_POOL - 1];
+	syncUnits();
+	setGamePhase(MOVE);
+
+	for (int i = 0; i < iterations; i++)
+	{
+		SDL_SetRenderDrawColor(renderer, BACKGROUND_WHITE.r, BACKGROUND_WHITE.g, BACKGROUND_WHITE.b, BACKGROUND_WHITE.a);
+		SDL_RenderClear(renderer);
+		renderGame();
+
+		// No present, it would wait for vsync. Reading a pixel back waits for the GPU to draw the frame instead.
+		Uint32 pixel;
+		SDL_Rect rect = { 0, 0, 1, 1 };
+		SDL_RenderReadPixels(renderer, &rect, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel));
+		benchmarkSink += pixel;
+	}
+}
@@ -0,0 +1,657 @@
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <Windows.h>
+#include <mmsystem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <rules.h>
+#include <evaluator.h>
+#include <evalprotocol.h>
+
+#define RECEIVE_BUFFER_SIZE 4096
+
+// Requests waiting for an evaluation thread, once it is full new ones are answered busy
+#define QUEUE_SIZE 65536
+#define MAX_BATCH 512
+// How long the first request of a batch waits for company, in microseconds
+#define BATCH_WAIT_US 1000
+// Answers a client has not taken yet, a client further behind is disconnected
+#define MAX_PENDING_SENDS 256
+
+typedef struct IoRequest IoRequest;
+typedef struct Connection Connection;
+typedef struct SendRequest SendRequest;
+typedef struct QueuedRequest QueuedRequest;
+typedef struct RequestQueue RequestQueue;
+typedef struct Batch Batch;
+
+/*
+ * Common head of everything posted to the completion port, so completions
+ * can be cast back to the receive or send they belong to.
+ */
+struct IoRequest
+{
+	OVERLAPPED overlapped;
+	int isSend;
+};
+
+/*
+ * One client. Only one receive is outstanding at a time. Every queued
+ * request and every pending send holds a reference, so the connection
+ * outlives its socket until the last answer has been dealt with. Sends are
+ * posted under sendLock, which only guards against the socket being closed
+ * meanwhile, nobody ever waits on the client while holding it. closing is
+ * set once a client fell too far behind, the I/O thread owning the receive
+ * then closes the connection instead of posting the next one.
+ */
+struct Connection
+{
+	IoRequest receive;
+	SOCKET socket;
+	WSABUF buffer;
+	Uint8 data[RECEIVE_BUFFER_SIZE];
+	int received;
+	volatile LONG references;
+	volatile LONG pendingSends;
+	CRITICAL_SECTION sendLock;
+	volatile LONG closing;
+	int closed;
+};
+
+// A copy of the answers, the evaluation thread reuses its batch before the send completes
+struct SendRequest
+{
+	IoRequest request;
+	Connection* connection;
+	WSABUF buffer;
+};
+
+struct QueuedRequest
+{
+	Connection* connection;
+	LONGLONG arrival;
+	EvalRequest request;
+};
+
+/*
+ * Ring buffer of requests from every connection. Evaluation threads take
+ * them out in batches of up to MAX_BATCH.
+ */
+struct RequestQueue
+{
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE notEmpty;
+	QueuedRequest* entries;
+	int head;
+	int count;
+};
+
+/*
+ * Working memory of one evaluation thread: the requests it took, every
+ * position it evaluates for them and the answers it sends back.
+ */
+struct Batch
+{
+	int count;
+	QueuedRequest requests[MAX_BATCH];
+	EvalResponse responses[MAX_BATCH];
+	int firstCandidate[MAX_BATCH];
+	int candidateCount[MAX_BATCH];
+	int candidateUnits[MAX_BATCH][MAX_TEAM_SIZE];
+	Position positions[MAX_BATCH * (MAX_TEAM_SIZE + 1)];
+	float values[MAX_BATCH * (MAX_TEAM_SIZE + 1) * MAX_TEAMS];
+	QueuedRequest* order[MAX_BATCH];
+	Uint8 answers[MAX_BATCH * EVAL_RESPONSE_MAX];
+};
+
+/* Variables */
+HANDLE completionPort;
+Rules rules;
+Weights weights;
+RequestQueue queue;
+LONGLONG counterFrequency;
+LONGLONG batchWaitTicks;
+volatile LONG connectionCount = 0;
+volatile LONG requestsServed = 0;
+volatile LONG batchesServed = 0;
+
+/* Funcion declarations */
+int init(const char* path, SOCKET* listener);
+DWORD WINAPI ioThread(LPVOID data);
+DWORD WINAPI evaluationThread(LPVOID data);
+DWORD WINAPI statsThread(LPVOID data);
+int postReceive(Connection* connection);
+void closeConnection(Connection* connection);
+int enqueueRequest(Connection* connection, const EvalRequest* request);
+void takeBatch(Batch* batch);
+void evaluateBatch(Batch* batch);
+void answerBatch(Batch* batch);
+void queueSend(Connection* connection, const Uint8* data, int size);
+void completeSend(SendRequest* request);
+void releaseConnection(Connection* connection);
+
+/* Function definitions */
+int main(int argc, char* args[])
+{
+	const char* path = argc > 1 ? args[1] : EVAL_SOCKET_PATH;
+	const char* weightPath = argc > 2 ? args[2] : "weights.bin";
+
+	// The standard board unless another variant is given, clients learn which from the hello
+	if (!setupRules(&rules,
+		argc > 3 ? atoi(args[3]) : STANDARD_TEAMS,
+		argc > 4 ? atoi(args[4]) : STANDARD_TEAM_SIZE,
+		argc > 5 ? atoi(args[5]) : STANDARD_RING_SIZE,
+		argc > 6 ? atoi(args[6]) : STANDARD_FINISH_SIZE))
+	{
+		printf("Usage: %s [socket path] [weight file] [teams] [team size] [ring size] [finish size]\n", args[0]);
+		return 1;
+	}
+
+	if (!loadWeights(&weights, weightPath))
+	{
+		printf("Evaluating with the default weights.\n");
+		defaultWeights(&weights);
+	}
+
+	SOCKET listener;
+	if (!init(path, &listener))
+	{
+		printf("Failed to initialize!\n");
+		return 1;
+	}
+
+	// Decoding requests is cheap next to evaluating them, most cores go to evaluation
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	int evaluatorCount = (int)info.dwNumberOfProcessors;
+	int ioCount = evaluatorCount / 4 > 0 ? evaluatorCount / 4 : 1;
+	for (int i = 0; i < ioCount; i++)
+	{
+		CloseHandle(CreateThread(NULL, 0, ioThread, NULL, 0, NULL));
+	}
+	for (int i = 0; i < evaluatorCount; i++)
+	{
+		CloseHandle(CreateThread(NULL, 0, evaluationThread, NULL, 0, NULL));
+	}
+	CloseHandle(CreateThread(NULL, 0, statsThread, NULL, 0, NULL));
+
+	printf("Evaluating %d teams of %d on a ring of %d at %s with %d threads.\n", rules.teams, rules.teamSize, rules.ringSize, path, evaluatorCount);
+
+	Uint8 hello[EVAL_HELLO_SIZE];
+	encodeEvalHello(&rules, hello);
+
+	for (;;)
+	{
+		SOCKET client = accept(listener, NULL, NULL);
+		if (client == INVALID_SOCKET)
+		{
+			printf("Failed to accept connection! Winsock Error: %d\n", WSAGetLastError());
+			continue;
+		}
+
+		Connection* connection = (Connection*)calloc(1, sizeof(Connection));
+		connection->socket = client;
+		connection->references = 1;
+		InitializeCriticalSection(&connection->sendLock);
+
+		if (CreateIoCompletionPort((HANDLE)client, completionPort, 0, 0) == NULL)
+		{
+			closesocket(client);
+			DeleteCriticalSection(&connection->sendLock);
+			free(connection);
+			continue;
+		}
+
+		InterlockedIncrement(&connectionCount);
+
+		// Posted before the first receive, so the hello goes out ahead of every answer
+		queueSend(connection, hello, EVAL_HELLO_SIZE);
+		if (!postReceive(connection))
+		{
+			closeConnection(connection);
+		}
+	}
+
+	return 0;
+}
+
+int init(const char* path, SOCKET* listener)
+{
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		printf("Winsock could not initialize!\n");
+		return 0;
+	}
+
+	queue.entries = (QueuedRequest*)malloc(QUEUE_SIZE * sizeof(QueuedRequest));
+	if (queue.entries == NULL)
+	{
+		printf("Unable to allocate the request queue!\n");
+		return 0;
+	}
+	InitializeCriticalSection(&queue.lock);
+	InitializeConditionVariable(&queue.notEmpty);
+
+	// Batch waits are timed with the performance counter, GetTickCount only moves every 15.6 ms
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	counterFrequency = frequency.QuadPart;
+	batchWaitTicks = counterFrequency * BATCH_WAIT_US / 1000000;
+
+	// Timed waits end on the scheduler tick, this brings it down from 15.6 ms to 1 ms for the whole system
+	if (timeBeginPeriod(1) != TIMERR_NOERROR)
+	{
+		printf("Unable to set a 1 ms timer period, lone requests may wait up to a scheduler tick.\n");
+	}
+
+	completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+	if (completionPort == NULL)
+	{
+		printf("Completion port could not be created! Error: %lu\n", GetLastError());
+		return 0;
+	}
+
+	*listener = WSASocket(AF_UNIX, SOCK_STREAM, 0, NULL, 0, WSA_FLAG_OVERLAPPED);
+	if (*listener == INVALID_SOCKET)
+	{
+		printf("Socket could not be created! Winsock Error: %d\n", WSAGetLastError());
+		return 0;
+	}
+
+	struct sockaddr_un address = { 0 };
+	address.sun_family = AF_UNIX;
+	SDL_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+
+	// The socket file of a previous run would make bind fail
+	DeleteFileA(path);
+
+	if (bind(*listener, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+		listen(*listener, SOMAXCONN) == SOCKET_ERROR)
+	{
+		printf("Unable to listen on %s! Winsock Error: %d\n", path, WSAGetLastError());
+		return 0;
+	}
+
+	return 1;
+}
+
+DWORD WINAPI ioThread(LPVOID data)
+{
+	int requestSize = evalRequestSize(&rules);
+
+	for (;;)
+	{
+		DWORD bytes = 0;
+		ULONG_PTR key;
+		OVERLAPPED* overlapped = NULL;
+		BOOL ok = GetQueuedCompletionStatus(completionPort, &bytes, &key, &overlapped, INFINITE);
+		if (overlapped == NULL)
+		{
+			// The port itself failed
+			break;
+		}
+
+		if (((IoRequest*)overlapped)->isSend)
+		{
+			completeSend((SendRequest*)overlapped);
+			continue;
+		}
+
+		Connection* connection = (Connection*)overlapped;
+		if (!ok || bytes == 0 || connection->closing)
+		{
+			closeConnection(connection);
+			continue;
+		}
+
+		// Queue every complete request and keep the rest for the next receive
+		connection->received += bytes;
+		int offset = 0;
+		while (connection->received - offset >= requestSize)
+		{
+			EvalRequest request;
+			int status = EVAL_INVALID;
+			if (decodeEvalRequest(&rules, &connection->data[offset], &request))
+			{
+				// Waiting for room would hold up the answers of every client on this thread
+				status = enqueueRequest(connection, &request) ? EVAL_OK : EVAL_BUSY;
+			}
+
+			if (status != EVAL_OK)
+			{
+				EvalResponse response = { .id = request.id, .status = (Uint8)status, .bestUnit = NO_MOVE };
+				Uint8 answer[EVAL_RESPONSE_MAX];
+				encodeEvalResponse(&rules, &response, answer);
+				queueSend(connection, answer, evalResponseSize(&rules));
+			}
+			offset += requestSize;
+		}
+
+		connection->received -= offset;
+		memmove(connection->data, &connection->data[offset], connection->received);
+
+		if (connection->closing || !postReceive(connection))
+		{
+			closeConnection(connection);
+		}
+	}
+
+	return 0;
+}
+
+DWORD WINAPI evaluationThread(LPVOID data)
+{
+	Batch* batch = (Batch*)malloc(sizeof(Batch));
+	if (batch == NULL)
+	{
+		printf("Unable to allocate an evaluation batch!\n");
+		return 1;
+	}
+
+	for (;;)
+	{
+		takeBatch(batch);
+		evaluateBatch(batch);
+		answerBatch(batch);
+
+		InterlockedExchangeAdd(&requestsServed, batch->count);
+		InterlockedIncrement(&batchesServed);
+	}
+
+	return 0;
+}
+
+DWORD WINAPI statsThread(LPVOID data)
+{
+	LONG lastRequests = 0, lastBatches = 0;
+	for (;;)
+	{
+		Sleep(1000);
+
+		LONG requests = requestsServed, batches = batchesServed;
+		LONG batchCount = batches - lastBatches;
+		printf("%ld connections, %ld evaluations/s, %ld batches/s, %.1f evaluations per batch\n",
+			connectionCount, requests - lastRequests, batchCount, batchCount > 0 ? (double)(requests - lastRequests) / batchCount : 0.0);
+
+		lastRequests = requests;
+		lastBatches = batches;
+	}
+
+	return 0;
+}
+
+int postReceive(Connection* connection)
+{
+	DWORD flags = 0;
+	memset(&connection->receive.overlapped, 0, sizeof(OVERLAPPED));
+	connection->buffer.buf = (char*)&connection->data[connection->received];
+	connection->buffer.len = RECEIVE_BUFFER_SIZE - connection->received;
+
+	if (WSARecv(connection->socket, &connection->buffer, 1, NULL, &flags, &connection->receive.overlapped, NULL) == SOCKET_ERROR &&
+		WSAGetLastError() != WSA_IO_PENDING)
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+void closeConnection(Connection* connection)
+{
+	// Answers still in the queue are dropped once they see the flag
+	EnterCriticalSection(&connection->sendLock);
+	connection->closed = 1;
+	closesocket(connection->socket);
+	LeaveCriticalSection(&connection->sendLock);
+
+	InterlockedDecrement(&connectionCount);
+	releaseConnection(connection);
+}
+
+int enqueueRequest(Connection* connection, const EvalRequest* request)
+{
+	EnterCriticalSection(&queue.lock);
+	if (queue.count == QUEUE_SIZE)
+	{
+		LeaveCriticalSection(&queue.lock);
+		return 0;
+	}
+
+	InterlockedIncrement(&connection->references);
+
+	QueuedRequest* entry = &queue.entries[(queue.head + queue.count) % QUEUE_SIZE];
+	entry->connection = connection;
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	entry->arrival = now.QuadPart;
+	entry->request = *request;
+	queue.count++;
+
+	// Only the first request of a batch has to wake someone, the rest are picked up with it
+	if (queue.count == 1 || queue.count == MAX_BATCH)
+	{
+		WakeConditionVariable(&queue.notEmpty);
+	}
+	LeaveCriticalSection(&queue.lock);
+
+	return 1;
+}
+
+void takeBatch(Batch* batch)
+{
+	EnterCriticalSection(&queue.lock);
+
+	// Under load batches fill up right away, a lone request waits BATCH_WAIT_US for others
+	for (;;)
+	{
+		while (queue.count == 0)
+		{
+			SleepConditionVariableCS(&queue.notEmpty, &queue.lock, INFINITE);
+		}
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		LONGLONG waited = now.QuadPart - queue.entries[queue.head].arrival;
+		if (queue.count >= MAX_BATCH || waited >= batchWaitTicks)
+		{
+			break;
+		}
+
+		// A timed wait can only end on the 1 ms tick, so whole milliseconds are slept and what is left is yielded away
+		DWORD remainingMs = (DWORD)((batchWaitTicks - waited) * 1000 / counterFrequency);
+		if (remainingMs > 0)
+		{
+			SleepConditionVariableCS(&queue.notEmpty, &queue.lock, remainingMs);
+		}
+		else
+		{
+			LeaveCriticalSection(&queue.lock);
+			SwitchToThread();
+			EnterCriticalSection(&queue.lock);
+		}
+	}
+
+	batch->count = queue.count < MAX_BATCH ? queue.count : MAX_BATCH;
+	for (int i = 0; i < batch->count; i++)
+	{
+		batch->requests[i] = queue.entries[(queue.head + i) % QUEUE_SIZE];
+	}
+	queue.head = (queue.head + batch->count) % QUEUE_SIZE;
+	queue.count -= batch->count;
+
+	// Leftovers are a batch of their own for the next free thread
+	if (queue.count > 0)
+	{
+		WakeConditionVariable(&queue.notEmpty);
+	}
+	LeaveCriticalSection(&queue.lock);
+}
+
+void evaluateBatch(Batch* batch)
+{
+	// Every requested position plus the result of each legal move, evaluated in a single call
+	for (int i = 0; i < batch->count; i++)
+	{
+		batch->positions[i] = batch->requests[i].request.position;
+	}
+
+	int positionCount = batch->count;
+	for (int i = 0; i < batch->count; i++)
+	{
+		const EvalRequest* request = &batch->requests[i].request;
+		batch->firstCandidate[i] = positionCount;
+		batch->candidateCount[i] = request->dieValue == 0 ? 0 : generateMoves(&rules, &request->position, request->dieValue, batch->candidateUnits[i]);
+
+		for (int j = 0; j < batch->candidateCount[i]; j++)
+		{
+			batch->positions[positionCount] = request->position;
+			applyMove(&rules, &batch->positions[positionCount], batch->candidateUnits[i][j], request->dieValue, NULL);
+			positionCount++;
+		}
+	}
+
+	evaluatePositions(&weights, &rules, batch->positions, positionCount, batch->values);
+
+	int teams = rules.teams;
+	for (int i = 0; i < batch->count; i++)
+	{
+		EvalResponse* response = &batch->responses[i];
+		response->id = batch->requests[i].request.id;
+		response->status = EVAL_OK;
+		response->bestUnit = NO_MOVE;
+
+		// Same choice as chooseMove: the candidate the mover likes best
+		const float* candidates = &batch->values[batch->firstCandidate[i] * teams];
+		int turn = batch->requests[i].request.position.turn;
+		int best = -1;
+		for (int j = 0; j < batch->candidateCount[i]; j++)
+		{
+			if (best < 0 || candidates[j * teams + turn] > candidates[best * teams + turn])
+			{
+				best = j;
+			}
+		}
+		if (best >= 0)
+		{
+			response->bestUnit = (Uint8)(batch->candidateUnits[i][best] % rules.teamSize);
+		}
+
+		// The evaluator scores every team on its own, normalize them into a distribution over the winner
+		const float* values = &batch->values[i * teams];
+		float total = 0;
+		for (int team = 0; team < teams; team++)
+		{
+			total += values[team];
+		}
+		for (int team = 0; team < teams; team++)
+		{
+			response->winProbability[team] = (Uint16)(values[team] / total * 65535.0f + 0.5f);
+		}
+	}
+}
+
+static int compareConnections(const void* a, const void* b)
+{
+	const QueuedRequest* x = *(const QueuedRequest* const*)a;
+	const QueuedRequest* y = *(const QueuedRequest* const*)b;
+	if (x->connection != y->connection)
+	{
+		return x->connection < y->connection ? -1 : 1;
+	}
+
+	return (x > y) - (x < y);
+}
+
+void answerBatch(Batch* batch)
+{
+	// Group the answers by connection, so each client gets one send per batch
+	for (int i = 0; i < batch->count; i++)
+	{
+		batch->order[i] = &batch->requests[i];
+	}
+	qsort(batch->order, batch->count, sizeof(QueuedRequest*), compareConnections);
+
+	int responseSize = evalResponseSize(&rules);
+	int start = 0;
+	while (start < batch->count)
+	{
+		Connection* connection = batch->order[start]->connection;
+		int size = 0;
+		int end = start;
+		for (; end < batch->count && batch->order[end]->connection == connection; end++)
+		{
+			encodeEvalResponse(&rules, &batch->responses[batch->order[end] - batch->requests], &batch->answers[size]);
+			size += responseSize;
+		}
+
+		queueSend(connection, batch->answers, size);
+
+		for (int i = start; i < end; i++)
+		{
+			releaseConnection(connection);
+		}
+		start = end;
+	}
+}
+
+void queueSend(Connection* connection, const Uint8* data, int size)
+{
+	// The send completes on an I/O thread, evaluation threads never wait on a slow client
+	SendRequest* request = (SendRequest*)malloc(sizeof(SendRequest) + size);
+	if (request == NULL)
+	{
+		return;
+	}
+	memset(request, 0, sizeof(SendRequest));
+	request->request.isSend = 1;
+	request->connection = connection;
+	request->buffer.len = (u_long)size;
+	request->buffer.buf = (char*)(request + 1);
+	memcpy(request->buffer.buf, data, size);
+
+	EnterCriticalSection(&connection->sendLock);
+	if (connection->closed || connection->closing || connection->pendingSends >= MAX_PENDING_SENDS)
+	{
+		// Ends a receive in flight, one not posted yet sees the flag instead
+		if (!connection->closed && !connection->closing)
+		{
+			InterlockedExchange(&connection->closing, 1);
+			shutdown(connection->socket, SD_BOTH);
+		}
+		LeaveCriticalSection(&connection->sendLock);
+		free(request);
+		return;
+	}
+
+	InterlockedIncrement(&connection->references);
+	InterlockedIncrement(&connection->pendingSends);
+
+	// A failed send shows up as a failed receive on the same connection
+	if (WSASend(connection->socket, &request->buffer, 1, NULL, 0, &request->request.overlapped, NULL) == SOCKET_ERROR &&
+		WSAGetLastError() != WSA_IO_PENDING)
+	{
+		LeaveCriticalSection(&connection->sendLock);
+
+		// No completion is coming for this one
+		completeSend(request);
+		return;
+	}
+	LeaveCriticalSection(&connection->sendLock);
+}
+
+void completeSend(SendRequest* request)
+{
+	InterlockedDecrement(&request->connection->pendingSends);
+	releaseConnection(request->connection);
+	free(request);
+}
+
+void releaseConnection(Connection* connection)
+{
+	if (InterlockedDecrement(&connection->references) == 0)
+	{
+		DeleteCriticalSection(&connection->sendLock);
+		free(connection);
+	}
+}
@@ -0,0 +1,469 @@
+#define SDL_MAIN_HANDLED
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+#include <texture.h>
+#include <gameObjects.h>
+#include <rules.h>
+#include <feed.h>
+#include <replay.h>
+#include <board.h>
+#include <boardview.h>
+
+// Frames look like the game window
+#define FRAME_WIDTH 640
+#define FRAME_HEIGHT 480
+#define BOARD_SIZE 400
+
+// How long each update of the replay stays on screen, in frames at 60 per second
+#define DIE_ANIMATION_FRAMES 60
+#define ROLL_FRAMES (DIE_ANIMATION_FRAMES + 15)
+#define MOVE_FRAMES 20
+#define END_FRAMES 120
+
+// Threads take the timeline in chunks, small enough to keep them all busy until the end
+#define CHUNK_FRAMES 32
+
+typedef enum { FORMAT_PNG, FORMAT_BMP, FORMAT_RAW } FrameFormat;
+typedef struct Snapshot Snapshot;
+typedef struct Exporter Exporter;
+
+/*
+ * The match after one update of the replay, and the first frame showing
+ * it. Frames in between are a pure function of the snapshot, so any
+ * thread can render any frame.
+ */
+struct Snapshot
+{
+	Position position;
+	int firstFrame;
+	int rolled;
+	int dieTeam;
+	int dieValue;
+	int winner;
+};
+
+/*
+ * Shared by all export threads, which only read it apart from the chunk
+ * counter and the result counters.
+ */
+struct Exporter
+{
+	const Rules* rules;
+	const Layout* layout;
+	Snapshot* snapshots;
+	int snapshotCount;
+	int frameCount;
+
+	// Rendered once up front, SDL_ttf is not safe to use from several threads
+	SDL_Surface* turnMessages[MAX_TEAMS];
+	SDL_Surface* winMessages[MAX_TEAMS];
+	SDL_Surface* abandonedMessage;
+
+	char assets[256];
+	const char* directory;
+	FrameFormat format;
+	SDL_mutex* setupLock;
+	SDL_atomic_t nextChunk;
+	SDL_atomic_t framesWritten;
+	SDL_atomic_t failed;
+};
+
+/* Funcion declarations */
+int buildTimeline(Exporter* exporter, const Replay* replay);
+int renderMessages(Exporter* exporter, TTF_Font* font);
+int exportThread(void* data);
+int textureFromSurface(Texture* texture, SDL_Renderer* renderer, SDL_Surface* surface);
+void renderFrame(Exporter* exporter, SDL_Renderer* renderer, const BoardView* view, Texture* playersSprite, Texture* dieTexture, Texture* messages, int frame, const Snapshot* snapshot);
+int saveFrame(Exporter* exporter, SDL_Surface* surface, int frame);
+
+/* Function definitions */
+int main(int argc, char* args[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s replay.bin [--out directory] [--format png|bmp|raw] [--threads n] [--assets game directory]\n", args[0]);
+		return 1;
+	}
+
+	Exporter exporter = { 0 };
+	exporter.directory = "frames";
+	exporter.format = FORMAT_PNG;
+	const char* assets = "..\\Game";
+	int threadCount = SDL_GetCPUCount();
+
+	for (int i = 2; i + 1 < argc; i += 2)
+	{
+		if (strcmp(args[i], "--out") == 0)
+		{
+			exporter.directory = args[i + 1];
+		}
+		else if (strcmp(args[i], "--format") == 0)
+		{
+			exporter.format = strcmp(args[i + 1], "raw") == 0 ? FORMAT_RAW : strcmp(args[i + 1], "bmp") == 0 ? FORMAT_BMP : FORMAT_PNG;
+		}
+		else if (strcmp(args[i], "--threads") == 0)
+		{
+			threadCount = SDL_max(1, atoi(args[i + 1]));
+		}
+		else if (strcmp(args[i], "--assets") == 0)
+		{
+			assets = args[i + 1];
+		}
+	}
+	SDL_strlcpy(exporter.assets, assets, sizeof(exporter.assets));
+
+	Replay replay;
+	if (!loadReplay(&replay, args[1]))
+	{
+		return 1;
+	}
+	exporter.rules = &replay.rules;
+
+	if (!buildTimeline(&exporter, &replay))
+	{
+		freeReplay(&replay);
+		return 1;
+	}
+
+	// Same board as the game would lay out for this variant
+	Layout* layout = (Layout*)malloc(sizeof(Layout));
+	BoardDescription description = { .teams = replay.rules.teams, .teamSize = replay.rules.teamSize,
+		.ringSize = replay.rules.ringSize, .finishSize = replay.rules.finishSize, .width = BOARD_SIZE, .height = BOARD_SIZE };
+	if (layout == NULL || !prepareLayout(layout, &description))
+	{
+		printf("Failed to lay out the board!\n");
+		return 1;
+	}
+	exporter.layout = layout;
+
+	SDL_SetMainReady();
+	if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) || TTF_Init() == -1)
+	{
+		printf("Failed to initialize SDL_image or SDL_ttf!\n");
+		return 1;
+	}
+
+	char fontPath[300];
+	SDL_snprintf(fontPath, sizeof(fontPath), "%s\\font.ttf", exporter.assets);
+	TTF_Font* font = TTF_OpenFont(fontPath, 28);
+	if (font == NULL || !renderMessages(&exporter, font))
+	{
+		printf("Failed to render the messages! SDL_ttf Error: %s\n", TTF_GetError());
+		return 1;
+	}
+
+	if (!CreateDirectoryA(exporter.directory, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		printf("Unable to create directory %s!\n", exporter.directory);
+		return 1;
+	}
+
+	printf("Exporting %d frames of %d updates to %s with %d threads.\n", exporter.frameCount, exporter.snapshotCount, exporter.directory, threadCount);
+
+	exporter.setupLock = SDL_CreateMutex();
+	SDL_Thread** threads = (SDL_Thread**)malloc(threadCount * sizeof(SDL_Thread*));
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads[i] = SDL_CreateThread(exportThread, "exporter", &exporter);
+	}
+	for (int i = 0; i < threadCount; i++)
+	{
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	int written = SDL_AtomicGet(&exporter.framesWritten);
+	printf("Wrote %d frames in %.2fs, %.0f frames/s, %.1fx real time.\n", written, seconds, written / seconds, written / 60.0 / seconds);
+
+	free(threads);
+	SDL_DestroyMutex(exporter.setupLock);
+	for (int i = 0; i < replay.rules.teams; i++)
+	{
+		SDL_FreeSurface(exporter.turnMessages[i]);
+		SDL_FreeSurface(exporter.winMessages[i]);
+	}
+	SDL_FreeSurface(exporter.abandonedMessage);
+	TTF_CloseFont(font);
+	TTF_Quit();
+	IMG_Quit();
+	free(exporter.snapshots);
+	free(layout);
+	freeReplay(&replay);
+
+	return SDL_AtomicGet(&exporter.failed) ? 1 : 0;
+}
+
+int buildTimeline(Exporter* exporter, const Replay* replay)
+{
+	FeedState state;
+	resetFeedState(&state, &replay->rules);
+
+	int capacity = 256;
+	exporter->snapshots = (Snapshot*)malloc(capacity * sizeof(Snapshot));
+	exporter->snapshotCount = 0;
+	exporter->frameCount = 0;
+
+	int offset = 0;
+	while (offset < replay->size)
+	{
+		int rollCount = state.rollCount;
+		int used = applyFeedUpdate(&state, &replay->updates[offset], replay->size - offset);
+		if (used < 0)
+		{
+			printf("Corrupt replay at byte %d!\n", offset);
+			return 0;
+		}
+		else if (used == 0)
+		{
+			// The recording was cut off in the middle of an update
+			break;
+		}
+		offset += used;
+
+		// A recording that started mid match has nothing to show until its first keyframe
+		if (!state.synced)
+		{
+			continue;
+		}
+
+		if (exporter->snapshotCount == capacity)
+		{
+			capacity *= 2;
+			exporter->snapshots = (Snapshot*)realloc(exporter->snapshots, capacity * sizeof(Snapshot));
+		}
+
+		Snapshot* snapshot = &exporter->snapshots[exporter->snapshotCount++];
+		*snapshot = (Snapshot){ .position = state.position, .firstFrame = exporter->frameCount, .rolled = state.rollCount != rollCount,
+			.dieTeam = state.dieTeam, .dieValue = state.dieValue, .winner = state.winner };
+
+		exporter->frameCount += snapshot->winner >= 0 ? END_FRAMES : snapshot->rolled ? ROLL_FRAMES : MOVE_FRAMES;
+	}
+
+	if (exporter->snapshotCount == 0)
+	{
+		printf("The replay holds no complete position!\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+int renderMessages(Exporter* exporter, TTF_Font* font)
+{
+	SDL_Color black = { 0, 0, 0, 0xFF };
+	char message[64];
+
+	for (int i = 0; i < exporter->rules->teams; i++)
+	{
+		SDL_snprintf(message, sizeof(message), "Team %s's turn.", TEAM_NAMES[i]);
+		exporter->turnMessages[i] = TTF_RenderText_Solid(font, message, black);
+
+		SDL_snprintf(message, sizeof(message), "Team %s won!", TEAM_NAMES[i]);
+		exporter->winMessages[i] = TTF_RenderText_Solid(font, message, black);
+
+		if (exporter->turnMessages[i] == NULL || exporter->winMessages[i] == NULL)
+		{
+			return 0;
+		}
+	}
+
+	exporter->abandonedMessage = TTF_RenderText_Solid(font, "The match was abandoned.", black);
+	return exporter->abandonedMessage != NULL;
+}
+
+int exportThread(void* data)
+{
+	Exporter* exporter = (Exporter*)data;
+	int teams = exporter->rules->teams;
+
+	// Every thread draws into its own surface with its own software renderer and textures
+	SDL_Surface* surface = SDL_CreateRGBSurface(0, FRAME_WIDTH, FRAME_HEIGHT, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+	SDL_Renderer* renderer = surface == NULL ? NULL : SDL_CreateSoftwareRenderer(surface);
+	BoardView* view = (BoardView*)malloc(sizeof(BoardView));
+	Texture playersSprite = { 0 }, dieTexture = { 0 };
+	Texture messages[2 * MAX_TEAMS + 1] = { 0 };
+
+	char playersPath[300], diePath[300];
+	SDL_snprintf(playersPath, sizeof(playersPath), "%s\\players.png", exporter->assets);
+	SDL_snprintf(diePath, sizeof(diePath), "%s\\die.png", exporter->assets);
+
+	// Setting up reads the shared surfaces, one thread at a time keeps that simple
+	SDL_LockMutex(exporter->setupLock);
+	int success = renderer != NULL && view != NULL &&
+		loadPlayersSprite(&playersSprite, renderer, playersPath) && loadTextureFromFile(&dieTexture, renderer, diePath);
+	for (int i = 0; i < teams && success; i++)
+	{
+		success = textureFromSurface(&messages[i], renderer, exporter->turnMessages[i]) &&
+			textureFromSurface(&messages[teams + i], renderer, exporter->winMessages[i]);
+	}
+	success = success && textureFromSurface(&messages[2 * teams], renderer, exporter->abandonedMessage);
+	SDL_UnlockMutex(exporter->setupLock);
+
+	if (!success)
+	{
+		printf("Export thread could not set up its renderer! SDL Error: %s\n", SDL_GetError());
+		SDL_AtomicSet(&exporter->failed, 1);
+	}
+	else
+	{
+		setupBoardView(view, exporter->layout, (FRAME_WIDTH - BOARD_SIZE) / 2, (FRAME_HEIGHT - BOARD_SIZE) / 2);
+	}
+
+	while (success && !SDL_AtomicGet(&exporter->failed))
+	{
+		int start = SDL_AtomicAdd(&exporter->nextChunk, 1) * CHUNK_FRAMES;
+		if (start >= exporter->frameCount)
+		{
+			break;
+		}
+		int end = SDL_min(start + CHUNK_FRAMES, exporter->frameCount);
+
+		// Find the snapshot on screen at the start of the chunk, then walk along with the frames
+		int low = 0, high = exporter->snapshotCount - 1;
+		while (low < high)
+		{
+			int middle = (low + high + 1) / 2;
+			if (exporter->snapshots[middle].firstFrame <= start)
+			{
+				low = middle;
+			}
+			else
+			{
+				high = middle - 1;
+			}
+		}
+
+		int current = low;
+		syncBoardView(view, &exporter->snapshots[current].position);
+		for (int frame = start; frame < end && success; frame++)
+		{
+			if (current + 1 < exporter->snapshotCount && exporter->snapshots[current + 1].firstFrame <= frame)
+			{
+				current++;
+				syncBoardView(view, &exporter->snapshots[current].position);
+			}
+
+			renderFrame(exporter, renderer, view, &playersSprite, &dieTexture, messages, frame, &exporter->snapshots[current]);
+			success = saveFrame(exporter, surface, frame);
+		}
+
+		if (!success)
+		{
+			SDL_AtomicSet(&exporter->failed, 1);
+		}
+	}
+
+	for (int i = 0; i < 2 * MAX_TEAMS + 1; i++)
+	{
+		freeTexture(&messages[i]);
+	}
+	freeTexture(&dieTexture);
+	freeTexture(&playersSprite);
+	free(view);
+	if (renderer != NULL)
+	{
+		SDL_DestroyRenderer(renderer);
+	}
+	SDL_FreeSurface(surface);
+
+	return 0;
+}
+
+int textureFromSurface(Texture* texture, SDL_Renderer* renderer, SDL_Surface* surface)
+{
+	freeTexture(texture);
+
+	texture->texture = SDL_CreateTextureFromSurface(renderer, surface);
+	if (texture->texture != NULL)
+	{
+		texture->width = surface->w;
+		texture->height = surface->h;
+	}
+
+	return texture->texture != NULL;
+}
+
+void renderFrame(Exporter* exporter, SDL_Renderer* renderer, const BoardView* view, Texture* playersSprite, Texture* dieTexture, Texture* messages, int frame, const Snapshot* snapshot)
+{
+	int teams = exporter->rules->teams;
+
+	SDL_SetRenderDrawColor(renderer, BACKGROUND_WHITE.r, BACKGROUND_WHITE.g, BACKGROUND_WHITE.b, BACKGROUND_WHITE.a);
+	SDL_RenderClear(renderer);
+
+	/* Render message, like the spectator shows it */
+	Texture* message;
+	if (snapshot->winner >= teams)
+	{
+		message = &messages[2 * teams];
+	}
+	else if (snapshot->winner >= 0)
+	{
+		message = &messages[teams + snapshot->winner];
+	}
+	else
+	{
+		message = &messages[snapshot->rolled ? snapshot->dieTeam % teams : snapshot->position.turn];
+	}
+	renderTexture(message, renderer, 10, 10, NULL, 0, NULL, SDL_FLIP_NONE);
+
+	renderBoard(view, renderer, playersSprite);
+
+	/* The die spins like in the game, then shows the value that was cast */
+	if (snapshot->rolled && snapshot->dieValue >= 1 && snapshot->dieValue <= 6)
+	{
+		int w = dieTexture->height;
+		int remainingFrames = DIE_ANIMATION_FRAMES - (frame - snapshot->firstFrame);
+		int x = remainingFrames >= 0 ? (remainingFrames * w) % (6 * w) : w * (snapshot->dieValue - 1);
+		SDL_Rect clip = { .x = x, .y = 0, .w = w, .h = w };
+		renderTexture(dieTexture, renderer, 50, 50, &clip, 0, NULL, SDL_FLIP_NONE);
+	}
+
+	SDL_RenderPresent(renderer);
+}
+
+int saveFrame(Exporter* exporter, SDL_Surface* surface, int frame)
+{
+	static const char* extensions[] = { "png", "bmp", "raw" };
+	char path[300];
+	SDL_snprintf(path, sizeof(path), "%s\\frame%06d.%s", exporter->directory, frame, extensions[exporter->format]);
+
+	int success;
+	if (exporter->format == FORMAT_PNG)
+	{
+		success = IMG_SavePNG(surface, path) == 0;
+	}
+	else if (exporter->format == FORMAT_BMP)
+	{
+		success = SDL_SaveBMP(surface, path) == 0;
+	}
+	else
+	{
+		// Rows of 32 bit BGRA pixels, no header, the size is always FRAME_WIDTH x FRAME_HEIGHT
+		FILE* file = fopen(path, "wb");
+		success = file != NULL;
+		for (int y = 0; y < surface->h && success; y++)
+		{
+			success = fwrite((Uint8*)surface->pixels + y * surface->pitch, 4, surface->w, file) == (size_t)surface->w;
+		}
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+	}
+
+	if (!success)
+	{
+		printf("Unable to write frame %s!\n", path);
+		return 0;
+	}
+
+	SDL_AtomicAdd(&exporter->framesWritten, 1);
+	return 1;
+}
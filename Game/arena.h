@@ -0,0 +1,118 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <texture.h>
+
+#define ARENA_ALIGNMENT 16
+
+typedef struct Arena Arena;
+typedef struct ArenaTexture ArenaTexture;
+
+/*
+ * Bump allocator for everything that lives as long as a scene. Objects are
+ * never freed one by one, resetting the arena releases all of them at once,
+ * including the SDL textures registered with it.
+ */
+struct Arena
+{
+	Uint8* memory;
+	size_t size;
+	size_t used;
+	ArenaTexture* textures;
+};
+
+struct ArenaTexture
+{
+	Texture* texture;
+	ArenaTexture* next;
+};
+
+// Arena functions
+int createArena(Arena* arena, size_t size);
+void destroyArena(Arena* arena);
+void resetArena(Arena* arena);
+void* arenaAlloc(Arena* arena, size_t size);
+Texture* arenaTexture(Arena* arena);
+int trackTexture(Arena* arena, Texture* texture);
+
+int createArena(Arena* arena, size_t size)
+{
+	arena->memory = (Uint8*)malloc(size);
+	arena->size = arena->memory == NULL ? 0 : size;
+	arena->used = 0;
+	arena->textures = NULL;
+
+	if (arena->memory == NULL)
+	{
+		printf("Unable to allocate arena of %u bytes!\n", (unsigned)size);
+	}
+
+	return arena->memory != NULL;
+}
+
+void destroyArena(Arena* arena)
+{
+	resetArena(arena);
+	free(arena->memory);
+	arena->memory = NULL;
+	arena->size = 0;
+}
+
+void resetArena(Arena* arena)
+{
+	//Free the textures, the memory holding them is simply reused
+	for (ArenaTexture* node = arena->textures; node != NULL; node = node->next)
+	{
+		freeTexture(node->texture);
+	}
+
+	arena->textures = NULL;
+	arena->used = 0;
+}
+
+void* arenaAlloc(Arena* arena, size_t size)
+{
+	size_t start = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	if (start + size > arena->size)
+	{
+		printf("Arena out of memory! %u of %u bytes used, %u requested\n", (unsigned)arena->used, (unsigned)arena->size, (unsigned)size);
+		return NULL;
+	}
+
+	arena->used = start + size;
+
+	//Hand out zeroed memory, like a fresh calloc
+	memset(&arena->memory[start], 0, size);
+	return &arena->memory[start];
+}
+
+Texture* arenaTexture(Arena* arena)
+{
+	Texture* texture = (Texture*)arenaAlloc(arena, sizeof(Texture));
+	if (texture != NULL && !trackTexture(arena, texture))
+	{
+		texture = NULL;
+	}
+
+	return texture;
+}
+
+int trackTexture(Arena* arena, Texture* texture)
+{
+	ArenaTexture* node = (ArenaTexture*)arenaAlloc(arena, sizeof(ArenaTexture));
+	if (node == NULL)
+	{
+		return 0;
+	}
+
+	node->texture = texture;
+	node->next = arena->textures;
+	arena->textures = node;
+
+	return 1;
+}
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <SDL_stdinc.h>
+#include <rules.h>
+#include <gameObjects.h>
+
+#define MAX_TILES (MAX_PROGRESS + MAX_TEAMS * (MAX_PROGRESS + MAX_TEAM_SIZE))
+#define LAYOUT_MAGIC 0x4C414946 // "FIAL"
+#define LAYOUT_VERSION 2
+#define NO_TEAM 0xFF
+#define BOARD_PI 3.14159265358979323846
+
+// Tile sizes the generator tries, largest first
+#define MAX_TILE_SIZE 46
+#define MIN_TILE_SIZE 4
+// Distance between neighbouring tile centers relative to the tile size, enough for squares at any angle
+#define TILE_SPACING 1.45
+// The hand placed standard board, a 7 by 7 grid of tiles
+#define STANDARD_TILE_SIZE 46
+#define STANDARD_TILE_SPACING 13
+#define STANDARD_BOARD_SIZE (7 * STANDARD_TILE_SIZE + 6 * STANDARD_TILE_SPACING)
+
+typedef struct BoardDescription BoardDescription;
+typedef struct LayoutTile LayoutTile;
+typedef struct Layout Layout;
+
+/*
+ * Everything needed to build a board: the variant and the pixel area it is
+ * laid out in.
+ */
+struct BoardDescription
+{
+	int teams;
+	int teamSize;
+	int ringSize;
+	int finishSize;
+	int width;
+	int height;
+};
+
+struct LayoutTile
+{
+	Sint16 x;
+	Sint16 y;
+	Sint16 size;
+	Sint16 next;
+	Uint8 type;
+	Uint8 team;
+	Uint8 color;
+};
+
+/*
+ * A generated board. Tiles are stored ring first (tile k is ring tile k),
+ * then every team's finish stretch, then the spawns. Positions are relative
+ * to the top left of the board area. route maps a unit's progress straight
+ * to the tile it stands on, -1 in the spawn and the goal. color is the team
+ * color a tile is painted in, NO_TEAM for plain ring tiles.
+ */
+struct Layout
+{
+	BoardDescription description;
+	Rules rules;
+	int tileCount;
+	LayoutTile tiles[MAX_TILES];
+	Sint16 route[MAX_TEAMS][MAX_PROGRESS + 1];
+	Sint16 spawn[MAX_TEAMS][MAX_TEAM_SIZE];
+};
+
+// Board functions
+void standardBoard(BoardDescription* description, int width, int height);
+int generateLayout(Layout* layout, const BoardDescription* description);
+int standardLayout(Layout* layout, const BoardDescription* description);
+int loadLayout(Layout* layout, const char* path, const BoardDescription* description);
+int saveLayout(const Layout* layout, const char* path);
+int prepareLayout(Layout* layout, const BoardDescription* description);
+
+void standardBoard(BoardDescription* description, int width, int height)
+{
+	*description = (BoardDescription){ .teams = STANDARD_TEAMS, .teamSize = STANDARD_TEAM_SIZE,
+		.ringSize = STANDARD_RING_SIZE, .finishSize = STANDARD_FINISH_SIZE, .width = width, .height = height };
+}
+
+static int addLayoutTile(Layout* layout, double x, double y, int size, TileType type, int team, int next)
+{
+	LayoutTile* tile = &layout->tiles[layout->tileCount];
+	tile->x = (Sint16)(x - size / 2);
+	tile->y = (Sint16)(y - size / 2);
+	tile->size = (Sint16)size;
+	tile->next = (Sint16)next;
+	tile->type = (Uint8)type;
+	tile->team = (Uint8)team;
+	tile->color = (Uint8)team;
+
+	return layout->tileCount++;
+}
+
+int generateLayout(Layout* layout, const BoardDescription* description)
+{
+	SDL_memset(layout, 0, sizeof(Layout));
+	layout->description = *description;
+
+	Rules* rules = &layout->rules;
+	if (!setupRules(rules, description->teams, description->teamSize, description->ringSize, description->finishSize))
+	{
+		return 0;
+	}
+
+	/*
+	 * The ring is a circle, the finish stretches run from it towards the
+	 * center and the spawns sit on a wider circle outside of it. Pick the
+	 * largest tile size for which all three fit into the board area.
+	 */
+	const double fullCircle = 2.0 * BOARD_PI;
+	double innerRadius = 0, ringRadius = 0, spawnRadius = 0;
+	double maxRadius = (description->width < description->height ? description->width : description->height) / 2.0;
+	int size;
+	for (size = MAX_TILE_SIZE; size >= MIN_TILE_SIZE; size--)
+	{
+		double spaced = size * TILE_SPACING;
+
+		innerRadius = SDL_max(size * 1.2, rules->teams * spaced / fullCircle);
+		ringRadius = SDL_max(rules->ringSize * spaced / fullCircle, innerRadius + rules->finishSize * spaced);
+		spawnRadius = SDL_max(ringRadius + size * 1.5, rules->teams * (rules->teamSize + 1) * spaced / fullCircle);
+
+		if (spawnRadius + size * 0.75 <= maxRadius)
+		{
+			break;
+		}
+	}
+
+	if (size < MIN_TILE_SIZE || MAX_TILES < rules->ringSize + rules->teams * (rules->finishSize + rules->teamSize))
+	{
+		printf("Board with %d teams and a ring of %d does not fit in %dx%d!\n", rules->teams, rules->ringSize, description->width, description->height);
+		return 0;
+	}
+
+	// The ring starts at the bottom and goes round clockwise, like the standard board
+	double centerX = description->width / 2.0;
+	double centerY = description->height / 2.0;
+	double ringStep = fullCircle / rules->ringSize;
+	for (int k = 0; k < rules->ringSize; k++)
+	{
+		double angle = BOARD_PI / 2 + k * ringStep;
+		addLayoutTile(layout, centerX + ringRadius * cos(angle), centerY + ringRadius * sin(angle), size, RING, NO_TEAM, (k + 1) % rules->ringSize);
+	}
+
+	for (int team = 0; team < rules->teams; team++)
+	{
+		int start = teamStartTile(rules, team);
+		double startAngle = BOARD_PI / 2 + start * ringStep;
+		layout->tiles[start].team = (Uint8)team;
+		layout->tiles[start].color = (Uint8)team;
+
+		for (int progress = 0; progress <= rules->goal; progress++)
+		{
+			int tile = ringTileOf(rules, team, progress);
+			layout->route[team][progress] = (Sint16)tile;
+		}
+
+		// The finish stretch leaves the ring right before the start tile
+		double finishAngle = startAngle - ringStep / 2;
+		double finishStep = (ringRadius - innerRadius) / rules->finishSize;
+		for (int k = 0; k < rules->finishSize; k++)
+		{
+			double radius = ringRadius - (k + 1) * finishStep;
+			int next = k + 1 < rules->finishSize ? layout->tileCount + 1 : -1;
+			int tile = addLayoutTile(layout, centerX + radius * cos(finishAngle), centerY + radius * sin(finishAngle), size, FINISH, team, next);
+			layout->route[team][rules->ringSize + 1 + k] = (Sint16)tile;
+		}
+
+		// Spawns are spread along the outer circle, centered on the start tile
+		double spawnStep = size * TILE_SPACING / spawnRadius;
+		for (int j = 0; j < rules->teamSize; j++)
+		{
+			double angle = startAngle + (j - (rules->teamSize - 1) / 2.0) * spawnStep;
+			layout->spawn[team][j] = (Sint16)addLayoutTile(layout, centerX + spawnRadius * cos(angle), centerY + spawnRadius * sin(angle), size, SPAWN, team, start);
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * The original board, tile by tile. Grid positions are in tiles from the
+ * top left, the ring tiles cycle through the four team colors and every
+ * start tile is painted in its own team's color.
+ */
+static const Uint8 STANDARD_RING[STANDARD_RING_SIZE][3] =
+{
+	{ 2, 6, 0 }, { 2, 5, 1 }, { 2, 4, 2 }, { 1, 4, 3 }, { 0, 4, 0 }, { 0, 3, 1 },
+	{ 0, 2, 1 }, { 1, 2, 2 }, { 2, 2, 3 }, { 2, 1, 0 }, { 2, 0, 1 }, { 3, 0, 2 },
+	{ 4, 0, 2 }, { 4, 1, 3 }, { 4, 2, 0 }, { 5, 2, 1 }, { 6, 2, 2 }, { 6, 3, 3 },
+	{ 6, 4, 3 }, { 5, 4, 0 }, { 4, 4, 1 }, { 4, 5, 2 }, { 4, 6, 3 }, { 3, 6, 0 }
+};
+static const Uint8 STANDARD_FINISH[STANDARD_TEAMS][STANDARD_FINISH_SIZE][2] =
+{
+	{ { 3, 5 }, { 3, 4 } }, { { 1, 3 }, { 2, 3 } }, { { 3, 1 }, { 3, 2 } }, { { 5, 3 }, { 4, 3 } }
+};
+// Spawns sit in the corners, in tiles from the corner they are drawn in
+static const Uint8 STANDARD_SPAWN[STANDARD_TEAMS][STANDARD_TEAM_SIZE][2] =
+{
+	{ { 0, 1 }, { 1, 1 }, { 0, 0 }, { 1, 0 } }, { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } },
+	{ { 1, 0 }, { 0, 0 }, { 1, 1 }, { 0, 1 } }, { { 1, 1 }, { 0, 1 }, { 1, 0 }, { 0, 0 } }
+};
+
+int standardLayout(Layout* layout, const BoardDescription* description)
+{
+	SDL_memset(layout, 0, sizeof(Layout));
+	layout->description = *description;
+
+	Rules* rules = &layout->rules;
+	if (!setupRules(rules, STANDARD_TEAMS, STANDARD_TEAM_SIZE, STANDARD_RING_SIZE, STANDARD_FINISH_SIZE))
+	{
+		return 0;
+	}
+
+	// Centered in the board area, each team's spawns are counted from the corner it sits in
+	int left = (description->width - STANDARD_BOARD_SIZE) / 2;
+	int top = (description->height - STANDARD_BOARD_SIZE) / 2;
+	int step = STANDARD_TILE_SIZE + STANDARD_TILE_SPACING;
+	const int cornerRight[STANDARD_TEAMS] = { 0, 0, 1, 1 };
+	const int cornerBottom[STANDARD_TEAMS] = { 1, 0, 0, 1 };
+
+	/* Ring */
+	for (int k = 0; k < STANDARD_RING_SIZE; k++)
+	{
+		int tile = addLayoutTile(layout, left + STANDARD_RING[k][0] * step + STANDARD_TILE_SIZE / 2, top + STANDARD_RING[k][1] * step + STANDARD_TILE_SIZE / 2,
+			STANDARD_TILE_SIZE, RING, NO_TEAM, (k + 1) % STANDARD_RING_SIZE);
+		layout->tiles[tile].color = STANDARD_RING[k][2];
+	}
+
+	/* Finish tiles */
+	for (int team = 0; team < STANDARD_TEAMS; team++)
+	{
+		layout->tiles[teamStartTile(rules, team)].team = (Uint8)team;
+
+		for (int progress = 0; progress <= rules->goal; progress++)
+		{
+			layout->route[team][progress] = (Sint16)ringTileOf(rules, team, progress);
+		}
+
+		for (int k = 0; k < STANDARD_FINISH_SIZE; k++)
+		{
+			int next = k + 1 < STANDARD_FINISH_SIZE ? layout->tileCount + 1 : -1;
+			int tile = addLayoutTile(layout, left + STANDARD_FINISH[team][k][0] * step + STANDARD_TILE_SIZE / 2, top + STANDARD_FINISH[team][k][1] * step + STANDARD_TILE_SIZE / 2,
+				STANDARD_TILE_SIZE, FINISH, team, next);
+			layout->route[team][STANDARD_RING_SIZE + 1 + k] = (Sint16)tile;
+		}
+	}
+
+	/* Spawn */
+	for (int team = 0; team < STANDARD_TEAMS; team++)
+	{
+		for (int j = 0; j < STANDARD_TEAM_SIZE; j++)
+		{
+			int x = STANDARD_SPAWN[team][j][0] * STANDARD_TILE_SIZE + STANDARD_TILE_SIZE / 2;
+			int y = STANDARD_SPAWN[team][j][1] * STANDARD_TILE_SIZE + STANDARD_TILE_SIZE / 2;
+			x = cornerRight[team] ? STANDARD_BOARD_SIZE - x : x;
+			y = cornerBottom[team] ? STANDARD_BOARD_SIZE - y : y;
+			layout->spawn[team][j] = (Sint16)addLayoutTile(layout, left + x, top + y, STANDARD_TILE_SIZE, SPAWN, team, teamStartTile(rules, team));
+		}
+	}
+
+	return 1;
+}
+
+int loadLayout(Layout* layout, const char* path, const BoardDescription* description)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return 0;
+	}
+
+	// The file is a plain dump of the struct, only good for the build that wrote it
+	Uint32 header[3];
+	int success = fread(header, sizeof(Uint32), 3, file) == 3 &&
+		header[0] == LAYOUT_MAGIC && header[1] == LAYOUT_VERSION && header[2] == sizeof(Layout) &&
+		fread(layout, sizeof(Layout), 1, file) == 1 &&
+		memcmp(&layout->description, description, sizeof(BoardDescription)) == 0;
+
+	if (!success)
+	{
+		printf("Layout file %s is outdated, generating the board again.\n", path);
+	}
+
+	fclose(file);
+	return success;
+}
+
+int saveLayout(const Layout* layout, const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Unable to write layout file %s!\n", path);
+		return 0;
+	}
+
+	Uint32 header[3] = { LAYOUT_MAGIC, LAYOUT_VERSION, sizeof(Layout) };
+	int success = fwrite(header, sizeof(Uint32), 3, file) == 3 &&
+		fwrite(layout, sizeof(Layout), 1, file) == 1;
+
+	fclose(file);
+	return success;
+}
+
+int prepareLayout(Layout* layout, const BoardDescription* description)
+{
+	// The standard variant keeps its hand placed board whenever there is room for it
+	if (description->teams == STANDARD_TEAMS && description->teamSize == STANDARD_TEAM_SIZE &&
+		description->ringSize == STANDARD_RING_SIZE && description->finishSize == STANDARD_FINISH_SIZE &&
+		description->width >= STANDARD_BOARD_SIZE && description->height >= STANDARD_BOARD_SIZE)
+	{
+		return standardLayout(layout, description);
+	}
+
+	// Every variant gets its own cache file next to the executable
+	char path[64];
+	SDL_snprintf(path, sizeof(path), "board-%d-%d-%d-%d-%dx%d.layout", description->teams, description->teamSize,
+		description->ringSize, description->finishSize, description->width, description->height);
+
+	if (loadLayout(layout, path, description))
+	{
+		return 1;
+	}
+
+	if (!generateLayout(layout, description))
+	{
+		return 0;
+	}
+
+	saveLayout(layout, path);
+	return 1;
+}
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef BOARDVIEW_H
+#define BOARDVIEW_H
+
+#include <SDL.h>
+#include <texture.h>
+#include <gameObjects.h>
+#include <rules.h>
+#include <board.h>
+
+typedef struct BoardView BoardView;
+
+const SDL_Color TEAM_COLORS[MAX_TEAMS] =
+{
+	{ 0xEE, 0x11, 0x11, 0xFF }, { 0x00, 0xAA, 0x22, 0xFF }, { 0x00, 0x44, 0xFF, 0xFF }, { 0xFF, 0xDD, 0x00, 0xFF },
+	{ 0x88, 0x22, 0xCC, 0xFF }, { 0xFF, 0x88, 0x00, 0xFF }, { 0x00, 0xBB, 0xCC, 0xFF }, { 0xFF, 0x66, 0xAA, 0xFF }
+};
+char* TEAM_NAMES[MAX_TEAMS] = { "Red", "Green", "Blue", "Yellow", "Purple", "Orange", "Cyan", "Pink" };
+const SDL_Color RING_GREY = { 0xC8, 0xC8, 0xC0, 0xFF };
+const SDL_Color BACKGROUND_WHITE = { 0xFA, 0xFA, 0xF0, 0xFF };
+const int playerWidth = 15;
+const int playerHeight = 23;
+
+/*
+ * The tiles and units of one board, placed on screen. Everything a frame
+ * of the board needs is in here, so any number of views can be drawn, to
+ * any renderer and from any thread.
+ */
+struct BoardView
+{
+	const Layout* layout;
+	Tile tiles[MAX_TILES];
+	int tileCount;
+	Team teams[MAX_TEAMS];
+};
+
+// Board view functions
+int loadPlayersSprite(Texture* texture, SDL_Renderer* renderer, char* path);
+void setupBoardView(BoardView* view, const Layout* layout, int left, int top);
+void syncBoardView(BoardView* view, const Position* pos);
+void renderBoardTiles(const BoardView* view, SDL_Renderer* renderer);
+void renderBoard(const BoardView* view, SDL_Renderer* renderer, Texture* playersSprite);
+
+/*
+ * Loads the sprite sheet of the four standard players, two by two, and adds
+ * a grey copy of the first one to the right of it. Color mods multiply, so the teams
+ * past the fourth are tinted from that neutral sprite, a colored one would
+ * turn muddy or black.
+ */
+int loadPlayersSprite(Texture* texture, SDL_Renderer* renderer, char* path)
+{
+	freeTexture(texture);
+
+	SDL_Surface* loadedSurface = IMG_Load(path);
+	if (loadedSurface == NULL)
+	{
+		printf("Unable to load image %s! SDL_image Error: %s\n", path, IMG_GetError());
+		return 0;
+	}
+
+	SDL_Surface* sheet = SDL_CreateRGBSurface(0, loadedSurface->w + playerWidth, loadedSurface->h, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+	if (sheet == NULL)
+	{
+		printf("Unable to create the players sheet! SDL Error: %s\n", SDL_GetError());
+		SDL_FreeSurface(loadedSurface);
+		return 0;
+	}
+
+	SDL_SetSurfaceBlendMode(loadedSurface, SDL_BLENDMODE_NONE);
+	SDL_FillRect(sheet, NULL, 0);
+	SDL_BlitSurface(loadedSurface, NULL, sheet, NULL);
+	SDL_FreeSurface(loadedSurface);
+
+	SDL_LockSurface(sheet);
+	for (int y = 0; y < sheet->h; y++)
+	{
+		Uint32* row = (Uint32*)((Uint8*)sheet->pixels + y * sheet->pitch);
+		for (int x = 0; x < sheet->w; x++)
+		{
+			// Same color key as loadTextureFromFile
+			if ((row[x] & 0x00FFFFFF) == 0x0000FFFF)
+			{
+				row[x] = 0;
+			}
+		}
+
+		// The brightest channel keeps the shading of the sprite and lets a tint reach its full color
+		if (y < playerHeight)
+		{
+			for (int x = 0; x < playerWidth; x++)
+			{
+				Uint32 pixel = row[x];
+				Uint32 grey = SDL_max(SDL_max((pixel >> 16) & 0xFF, (pixel >> 8) & 0xFF), pixel & 0xFF);
+				row[2 * playerWidth + x] = (pixel & 0xFF000000) | (grey << 16) | (grey << 8) | grey;
+			}
+		}
+	}
+	SDL_UnlockSurface(sheet);
+
+	texture->texture = SDL_CreateTextureFromSurface(renderer, sheet);
+	if (texture->texture == NULL)
+	{
+		printf("Unable to create texture from %s! SDL Error: %s\n", path, SDL_GetError());
+	}
+	else
+	{
+		texture->width = sheet->w;
+		texture->height = sheet->h;
+	}
+
+	SDL_FreeSurface(sheet);
+	return texture->texture != NULL;
+}
+
+void setupBoardView(BoardView* view, const Layout* layout, int left, int top)
+{
+	const Rules* rules = &layout->rules;
+	view->layout = layout;
+
+	/* Tiles */
+	view->tileCount = layout->tileCount;
+	for (int i = 0; i < view->tileCount; i++)
+	{
+		const LayoutTile* tile = &layout->tiles[i];
+		view->tiles[i] = (Tile){ .nextTile = tile->next < 0 ? NULL : &view->tiles[tile->next], .posX = left + tile->x, .posY = top + tile->y, .radius = tile->size, .type = (TileType)tile->type, .unit = NULL };
+		view->tiles[i].color = tile->color == NO_TEAM ? RING_GREY : TEAM_COLORS[tile->color];
+	}
+
+	/* Teams */
+	for (int i = 0; i < rules->teams; i++)
+	{
+		Team* team = &view->teams[i];
+		*team = (Team){ .finish = &view->tiles[layout->route[i][rules->ringSize + 1]], .name = TEAM_NAMES[i] };
+		team->playerClip = (SDL_Rect){ .x = (i % 2) * playerWidth, .y = (i / 2 % 2) * playerHeight, .w = playerWidth, .h = playerHeight };
+		if (i >= 4)
+		{
+			team->playerClip.x = 2 * playerWidth;
+			team->playerClip.y = 0;
+		}
+
+		for (int j = 0; j < rules->teamSize; j++)
+		{
+			team->spawn[j] = &view->tiles[layout->spawn[i][j]];
+			team->units[j] = (Unit){ .team = team, .position = team->spawn[j], .finished = 0 };
+		}
+	}
+}
+
+void syncBoardView(BoardView* view, const Position* pos)
+{
+	const Rules* rules = &view->layout->rules;
+
+	/* Place the units on the tiles matching their progress */
+	for (int i = 0; i < view->tileCount; i++)
+	{
+		view->tiles[i].unit = NULL;
+	}
+
+	for (int i = 0; i < rules->teams; i++)
+	{
+		for (int j = 0; j < rules->teamSize; j++)
+		{
+			Unit* unit = &view->teams[i].units[j];
+			int progress = pos->progress[i * rules->teamSize + j];
+			int tile = view->layout->route[i][progress];
+
+			unit->finished = progress == rules->goal;
+			if (progress == PROGRESS_SPAWN)
+			{
+				unit->position = view->teams[i].spawn[j];
+			}
+			else
+			{
+				unit->position = tile < 0 ? NULL : &view->tiles[tile];
+			}
+
+			if (unit->position != NULL)
+			{
+				unit->position->unit = unit;
+			}
+		}
+	}
+}
+
+void renderBoardTiles(const BoardView* view, SDL_Renderer* renderer)
+{
+	for (int i = 0; i < view->tileCount; i++)
+	{
+		const Tile* tile = &view->tiles[i];
+		SDL_Rect rect = { tile->posX, tile->posY, tile->radius, tile->radius };
+		SDL_SetRenderDrawColor(renderer, tile->color.r, tile->color.g, tile->color.b, tile->color.a);
+		SDL_RenderFillRect(renderer, &rect);
+	}
+}
+
+void renderBoard(const BoardView* view, SDL_Renderer* renderer, Texture* playersSprite)
+{
+	const Rules* rules = &view->layout->rules;
+
+	/* Render tiles */
+	renderBoardTiles(view, renderer);
+
+	/* Render sprites */
+	for (int i = 0; i < rules->teams; i++)
+	{
+		// The sprite sheet holds four players, the teams after them tint the neutral one in their own color
+		if (i >= 4)
+		{
+			setTextureColor(playersSprite, TEAM_COLORS[i].r, TEAM_COLORS[i].g, TEAM_COLORS[i].b);
+		}
+
+		for (int j = 0; j < rules->teamSize; j++)
+		{
+			const Unit* unit = &view->teams[i].units[j];
+
+			// A unit without a tile has nowhere to be drawn
+			if (!unit->finished && unit->position != NULL)
+			{
+				int posX = (unit->position->posX + (unit->position->radius / 2)) - (playerWidth / 2);
+				int posY = (unit->position->posY + (unit->position->radius / 2)) - (playerHeight / 2);
+				renderTexture(playersSprite, renderer, posX, posY, (SDL_Rect*)&view->teams[i].playerClip, 0, NULL, SDL_FLIP_NONE);
+			}
+		}
+
+		if (i >= 4)
+		{
+			setTextureColor(playersSprite, 0xFF, 0xFF, 0xFF);
+		}
+	}
+}
+
+#endif
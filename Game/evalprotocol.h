@@ -0,0 +1,220 @@
+#ifndef EVALPROTOCOL_H
+#define EVALPROTOCOL_H
+
+#include <winsock2.h>
+#include <stdio.h>
+#include <SDL_stdinc.h>
+#include <rules.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+#define EVAL_SOCKET_PATH "fia-eval.sock"
+#define EVAL_HELLO_SIZE 8
+#define EVAL_VERSION 1
+#define EVAL_REQUEST_HEADER_SIZE 6
+#define EVAL_RESPONSE_HEADER_SIZE 6
+#define EVAL_REQUEST_MAX (EVAL_REQUEST_HEADER_SIZE + MAX_UNITS)
+#define EVAL_RESPONSE_MAX (EVAL_RESPONSE_HEADER_SIZE + 2 * MAX_TEAMS)
+#define NO_MOVE 0xFF
+
+// Older SDKs have no afunix.h, the address layout is the same as on Unix
+#ifndef UNIX_PATH_MAX
+#define UNIX_PATH_MAX 108
+typedef struct sockaddr_un
+{
+	ADDRESS_FAMILY sun_family;
+	char sun_path[UNIX_PATH_MAX];
+} SOCKADDR_UN;
+#endif
+
+typedef struct EvalRequest EvalRequest;
+typedef struct EvalResponse EvalResponse;
+
+typedef enum { EVAL_OK, EVAL_INVALID, EVAL_BUSY } EvalStatus;
+
+/*
+ * Evaluation service wire format. On connecting the service sends a hello:
+ * 'F', 'E', version, teams, team size, ring size, finish size, 0. Requests
+ * and responses are sized for that board.
+ *
+ * Request: id (4), die value (1, 0 to only evaluate), turn (1), then one
+ * progress byte per unit. Response: id (4), status (1), best unit of the
+ * team to move (1, NO_MOVE if there is none or no die was given), then
+ * every team's win probability in 1/65535 (2 each).
+ *
+ * Clients may send any number of requests without waiting, responses
+ * carry the request id and can come back in any order. A service with a
+ * full queue answers EVAL_BUSY at once, the request may be sent again.
+ */
+struct EvalRequest
+{
+	Uint32 id;
+	Uint8 dieValue;
+	Position position;
+};
+
+struct EvalResponse
+{
+	Uint32 id;
+	Uint8 status;
+	Uint8 bestUnit;
+	Uint16 winProbability[MAX_TEAMS];
+};
+
+// Evaluation protocol functions
+void encodeEvalHello(const Rules* rules, Uint8* data);
+int decodeEvalHello(const Uint8* data, Rules* rules);
+int evalRequestSize(const Rules* rules);
+int evalResponseSize(const Rules* rules);
+void encodeEvalRequest(const Rules* rules, const EvalRequest* request, Uint8* data);
+int decodeEvalRequest(const Rules* rules, const Uint8* data, EvalRequest* request);
+void encodeEvalResponse(const Rules* rules, const EvalResponse* response, Uint8* data);
+void decodeEvalResponse(const Rules* rules, const Uint8* data, EvalResponse* response);
+SOCKET connectEvalService(const char* path, Rules* rules);
+
+void encodeEvalHello(const Rules* rules, Uint8* data)
+{
+	data[0] = 'F';
+	data[1] = 'E';
+	data[2] = EVAL_VERSION;
+	data[3] = (Uint8)rules->teams;
+	data[4] = (Uint8)rules->teamSize;
+	data[5] = (Uint8)rules->ringSize;
+	data[6] = (Uint8)rules->finishSize;
+	data[7] = 0;
+}
+
+int decodeEvalHello(const Uint8* data, Rules* rules)
+{
+	if (data[0] != 'F' || data[1] != 'E' || data[2] != EVAL_VERSION)
+	{
+		printf("Unknown evaluation service version!\n");
+		return 0;
+	}
+
+	return setupRules(rules, data[3], data[4], data[5], data[6]);
+}
+
+int evalRequestSize(const Rules* rules)
+{
+	return EVAL_REQUEST_HEADER_SIZE + rules->units;
+}
+
+int evalResponseSize(const Rules* rules)
+{
+	return EVAL_RESPONSE_HEADER_SIZE + 2 * rules->teams;
+}
+
+static void encodeUint32(Uint32 value, Uint8* data)
+{
+	data[0] = (Uint8)(value >> 24);
+	data[1] = (Uint8)(value >> 16);
+	data[2] = (Uint8)(value >> 8);
+	data[3] = (Uint8)value;
+}
+
+static Uint32 decodeUint32(const Uint8* data)
+{
+	return ((Uint32)data[0] << 24) | ((Uint32)data[1] << 16) | ((Uint32)data[2] << 8) | data[3];
+}
+
+void encodeEvalRequest(const Rules* rules, const EvalRequest* request, Uint8* data)
+{
+	encodeUint32(request->id, data);
+	data[4] = request->dieValue;
+	data[5] = request->position.turn;
+	SDL_memcpy(&data[EVAL_REQUEST_HEADER_SIZE], request->position.progress, rules->units);
+}
+
+int decodeEvalRequest(const Rules* rules, const Uint8* data, EvalRequest* request)
+{
+	resetPosition(&request->position);
+	request->id = decodeUint32(data);
+	request->dieValue = data[4];
+	request->position.turn = data[5];
+	SDL_memcpy(request->position.progress, &data[EVAL_REQUEST_HEADER_SIZE], rules->units);
+
+	// Anything off the board would index past the rules' lookup tables
+	int valid = request->dieValue <= MAX_DIE && request->position.turn < rules->teams;
+	for (int i = 0; i < rules->units && valid; i++)
+	{
+		valid = request->position.progress[i] <= rules->goal;
+	}
+
+	return valid;
+}
+
+void encodeEvalResponse(const Rules* rules, const EvalResponse* response, Uint8* data)
+{
+	encodeUint32(response->id, data);
+	data[4] = response->status;
+	data[5] = response->bestUnit;
+	for (int i = 0; i < rules->teams; i++)
+	{
+		data[EVAL_RESPONSE_HEADER_SIZE + 2 * i] = (Uint8)(response->winProbability[i] >> 8);
+		data[EVAL_RESPONSE_HEADER_SIZE + 2 * i + 1] = (Uint8)response->winProbability[i];
+	}
+}
+
+void decodeEvalResponse(const Rules* rules, const Uint8* data, EvalResponse* response)
+{
+	SDL_memset(response, 0, sizeof(EvalResponse));
+	response->id = decodeUint32(data);
+	response->status = data[4];
+	response->bestUnit = data[5];
+	for (int i = 0; i < rules->teams; i++)
+	{
+		response->winProbability[i] = (Uint16)((data[EVAL_RESPONSE_HEADER_SIZE + 2 * i] << 8) | data[EVAL_RESPONSE_HEADER_SIZE + 2 * i + 1]);
+	}
+}
+
+SOCKET connectEvalService(const char* path, Rules* rules)
+{
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		printf("Winsock could not initialize!\n");
+		return INVALID_SOCKET;
+	}
+
+	struct sockaddr_un address = { 0 };
+	address.sun_family = AF_UNIX;
+	SDL_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+
+	SOCKET service = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (service == INVALID_SOCKET || connect(service, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR)
+	{
+		printf("Unable to connect to the evaluation service at %s! Winsock Error: %d\n", path, WSAGetLastError());
+		if (service != INVALID_SOCKET)
+		{
+			closesocket(service);
+		}
+		WSACleanup();
+		return INVALID_SOCKET;
+	}
+
+	//The service starts by telling which board it evaluates
+	Uint8 hello[EVAL_HELLO_SIZE];
+	int received = 0;
+	while (received < EVAL_HELLO_SIZE)
+	{
+		int bytes = recv(service, (char*)&hello[received], EVAL_HELLO_SIZE - received, 0);
+		if (bytes <= 0)
+		{
+			break;
+		}
+		received += bytes;
+	}
+
+	if (received < EVAL_HELLO_SIZE || !decodeEvalHello(hello, rules))
+	{
+		printf("The evaluation service did not say hello!\n");
+		closesocket(service);
+		WSACleanup();
+		return INVALID_SOCKET;
+	}
+
+	return service;
+}
+
+#endif
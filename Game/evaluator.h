@@ -0,0 +1,347 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <rules.h>
+
+#if !defined(FIA_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FIA_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define featureCount 16
+#define WEIGHTS_MAGIC 0x57414946 // "FIAW"
+// Version 2: the last feature became the opponents' threatening share, it used to be a constant zero
+#define WEIGHTS_VERSION 2
+
+// How far a unit on the ring can be reached by a single die cast
+#define PROD_REACH 6
+
+typedef struct Weights Weights;
+
+/*
+ * Linear evaluator over position features. The value of a position for a
+ * team is sigmoid(w . f) where f are the features seen from that team.
+ */
+struct Weights
+{
+	float w[featureCount];
+};
+
+void defaultWeights(Weights* weights);
+int loadWeights(Weights* weights, const char* path);
+int saveWeights(const Weights* weights, const char* path);
+void extractFeatures(const Rules* rules, const Position* positions, int count, float* features);
+void evaluatePositions(const Weights* weights, const Rules* rules, const Position* positions, int count, float* values);
+float evaluateFeatures(const Weights* weights, const float* features);
+int chooseMove(const Weights* weights, const Rules* rules, const Position* pos, int dieValue);
+
+void defaultWeights(Weights* weights)
+{
+	// Hand tuned starting point, used when no trained weight file is present
+	static const float initial[featureCount] =
+	{
+		-1.0f, -1.0f, 1.5f, 3.0f, 0.5f, -1.0f, 0.5f,
+		0.5f, -1.5f, -3.0f, 0.5f, -1.0f, 1.0f, 0.1f, 0.0f, -0.5f
+	};
+
+	memcpy(weights->w, initial, sizeof(initial));
+}
+
+int loadWeights(Weights* weights, const char* path)
+{
+	int success = 1;
+
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		printf("Unable to open weight file %s!\n", path);
+		return 0;
+	}
+
+	Uint32 header[3];
+	Weights loaded;
+	if (fread(header, sizeof(Uint32), 3, file) != 3 ||
+		header[0] != WEIGHTS_MAGIC || header[1] != WEIGHTS_VERSION || header[2] != featureCount)
+	{
+		printf("Weight file %s has an unknown format!\n", path);
+		success = 0;
+	}
+	else if (fread(loaded.w, sizeof(float), featureCount, file) != featureCount)
+	{
+		printf("Weight file %s is truncated!\n", path);
+		success = 0;
+	}
+	else
+	{
+		*weights = loaded;
+	}
+
+	fclose(file);
+	return success;
+}
+
+int saveWeights(const Weights* weights, const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Unable to write weight file %s!\n", path);
+		return 0;
+	}
+
+	Uint32 header[3] = { WEIGHTS_MAGIC, WEIGHTS_VERSION, featureCount };
+	int success = fwrite(header, sizeof(Uint32), 3, file) == 3 &&
+		fwrite(weights->w, sizeof(float), featureCount, file) == featureCount;
+
+	fclose(file);
+	return success;
+}
+
+/*
+ * Per unit flags of one position. Each entry is 1 or 0, so the team
+ * totals are plain sums over the team's lanes.
+ */
+typedef struct UnitFlags
+{
+	Uint8 spawn[MAX_UNITS];
+	Uint8 goal[MAX_UNITS];
+	Uint8 stretch[MAX_UNITS];
+	Uint8 exposed[MAX_UNITS];
+	Uint8 threatening[MAX_UNITS];
+} UnitFlags;
+
+static void computeUnitFlags(const Rules* rules, const Position* pos, UnitFlags* flags)
+{
+	// Lanes past the last unit are padding, off the ring so they never count as enemies
+	Uint8 ringTile[MAX_UNITS];
+	for (int i = 0; i < MAX_UNITS; i++)
+	{
+		ringTile[i] = i < rules->units ? rules->ringTile[rules->teamOf[i]][pos->progress[i]] : NOT_ON_RING;
+	}
+
+#ifdef FIA_SSE2
+	// Units are handled 16 lanes at a time, the standard board fits in one vector
+	SDL_COMPILE_TIME_ASSERT(unitLanes, MAX_UNITS % 16 == 0 && MAX_PROGRESS < 128);
+
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ring = _mm_set1_epi8((char)rules->ringSize);
+	const __m128i reach = _mm_set1_epi8(PROD_REACH + 1);
+
+	for (int base = 0; base < rules->units; base += 16)
+	{
+		__m128i progress = _mm_loadu_si128((const __m128i*)&pos->progress[base]);
+		__m128i tiles = _mm_loadu_si128((const __m128i*)&ringTile[base]);
+		__m128i teams = _mm_loadu_si128((const __m128i*)&rules->teamOf[base]);
+		__m128i onRing = _mm_andnot_si128(_mm_cmpeq_epi8(tiles, _mm_set1_epi8((char)NOT_ON_RING)), _mm_set1_epi8((char)0xFF));
+		__m128i stretch = _mm_and_si128(_mm_cmpgt_epi8(progress, ring),
+			_mm_cmplt_epi8(progress, _mm_set1_epi8((char)rules->goal)));
+
+		_mm_storeu_si128((__m128i*)&flags->spawn[base], _mm_and_si128(_mm_cmpeq_epi8(progress, zero), one));
+		_mm_storeu_si128((__m128i*)&flags->goal[base], _mm_and_si128(_mm_cmpeq_epi8(progress, _mm_set1_epi8((char)rules->goal)), one));
+		_mm_storeu_si128((__m128i*)&flags->stretch[base], _mm_and_si128(stretch, one));
+
+		// Compare every unit on the ring against all lanes at once
+		__m128i exposed = zero;
+		__m128i threatening = zero;
+		for (int j = 0; j < rules->units; j++)
+		{
+			if (ringTile[j] == NOT_ON_RING)
+			{
+				continue;
+			}
+
+			// Lanes holding units on the ring that belong to another team than unit j
+			__m128i enemies = _mm_andnot_si128(_mm_cmpeq_epi8(teams, _mm_set1_epi8((char)rules->teamOf[j])), onRing);
+
+			// Distance from unit j forward to each lane, and back, wrapped onto the ring
+			__m128i other = _mm_set1_epi8((char)ringTile[j]);
+			__m128i ahead = _mm_sub_epi8(tiles, other);
+			ahead = _mm_add_epi8(ahead, _mm_and_si128(_mm_cmplt_epi8(ahead, zero), ring));
+			__m128i behind = _mm_sub_epi8(other, tiles);
+			behind = _mm_add_epi8(behind, _mm_and_si128(_mm_cmplt_epi8(behind, zero), ring));
+
+			__m128i inReachAhead = _mm_and_si128(_mm_cmpgt_epi8(ahead, zero), _mm_cmplt_epi8(ahead, reach));
+			__m128i inReachBehind = _mm_and_si128(_mm_cmpgt_epi8(behind, zero), _mm_cmplt_epi8(behind, reach));
+
+			exposed = _mm_or_si128(exposed, _mm_and_si128(inReachAhead, enemies));
+			threatening = _mm_or_si128(threatening, _mm_and_si128(inReachBehind, enemies));
+		}
+
+		_mm_storeu_si128((__m128i*)&flags->exposed[base], _mm_and_si128(exposed, one));
+		_mm_storeu_si128((__m128i*)&flags->threatening[base], _mm_and_si128(threatening, one));
+	}
+#else
+	int ringSize = rules->ringSize;
+	for (int i = 0; i < rules->units; i++)
+	{
+		int progress = pos->progress[i];
+		flags->spawn[i] = progress == PROGRESS_SPAWN;
+		flags->goal[i] = progress == rules->goal;
+		flags->stretch[i] = progress > ringSize && progress < rules->goal;
+		flags->exposed[i] = 0;
+		flags->threatening[i] = 0;
+
+		if (ringTile[i] == NOT_ON_RING)
+		{
+			continue;
+		}
+
+		for (int j = 0; j < rules->units; j++)
+		{
+			if (ringTile[j] == NOT_ON_RING || rules->teamOf[i] == rules->teamOf[j])
+			{
+				continue;
+			}
+
+			int ahead = (ringTile[i] - ringTile[j] + ringSize) % ringSize;
+			int behind = (ringTile[j] - ringTile[i] + ringSize) % ringSize;
+			flags->exposed[i] |= ahead > 0 && ahead <= PROD_REACH;
+			flags->threatening[i] |= behind > 0 && behind <= PROD_REACH;
+		}
+	}
+#endif
+}
+
+void extractFeatures(const Rules* rules, const Position* positions, int count, float* features)
+{
+	int teams = rules->teams;
+	int teamSize = rules->teamSize;
+
+	// Output layout is [position][team][feature], for the teams of the board
+	for (int p = 0; p < count; p++)
+	{
+		const Position* pos = &positions[p];
+		UnitFlags flags;
+		computeUnitFlags(rules, pos, &flags);
+
+		float spawn[MAX_TEAMS], goal[MAX_TEAMS], progress[MAX_TEAMS], stretch[MAX_TEAMS];
+		float exposed[MAX_TEAMS], threatening[MAX_TEAMS];
+		for (int team = 0; team < teams; team++)
+		{
+			int s = 0, g = 0, pr = 0, st = 0, ex = 0, th = 0;
+			for (int i = team * teamSize; i < (team + 1) * teamSize; i++)
+			{
+				s += flags.spawn[i];
+				g += flags.goal[i];
+				st += flags.stretch[i];
+				ex += flags.exposed[i];
+				th += flags.threatening[i];
+				pr += pos->progress[i];
+			}
+
+			spawn[team] = (float)s / teamSize;
+			goal[team] = (float)g / teamSize;
+			stretch[team] = (float)st / teamSize;
+			exposed[team] = (float)ex / teamSize;
+			threatening[team] = (float)th / teamSize;
+			progress[team] = (float)pr / (teamSize * rules->goal);
+		}
+
+		for (int team = 0; team < teams; team++)
+		{
+			float* f = &features[(p * teams + team) * featureCount];
+
+			float otherSpawn = 0, otherGoal = 0, otherProgress = 0, otherExposed = 0, otherThreatening = 0, bestOther = 0;
+			for (int other = 0; other < teams; other++)
+			{
+				if (other == team)
+				{
+					continue;
+				}
+
+				otherSpawn += spawn[other];
+				otherGoal += goal[other];
+				otherProgress += progress[other];
+				otherExposed += exposed[other];
+				otherThreatening += threatening[other];
+				if (progress[other] > bestOther)
+				{
+					bestOther = progress[other];
+				}
+			}
+
+			f[0] = 1.0f;
+			f[1] = spawn[team];
+			f[2] = goal[team];
+			f[3] = progress[team];
+			f[4] = stretch[team];
+			f[5] = exposed[team];
+			f[6] = threatening[team];
+			f[7] = otherSpawn / (teams - 1);
+			f[8] = otherGoal / (teams - 1);
+			f[9] = otherProgress / (teams - 1);
+			f[10] = otherExposed / (teams - 1);
+			f[11] = bestOther;
+			f[12] = progress[team] - bestOther;
+			f[13] = pos->turn == team ? 1.0f : 0.0f;
+			f[14] = progress[team] * progress[team];
+			f[15] = otherThreatening / (teams - 1);
+		}
+	}
+}
+
+float evaluateFeatures(const Weights* weights, const float* features)
+{
+	float sum = 0;
+	for (int i = 0; i < featureCount; i++)
+	{
+		sum += weights->w[i] * features[i];
+	}
+
+	return 1.0f / (1.0f + expf(-sum));
+}
+
+void evaluatePositions(const Weights* weights, const Rules* rules, const Position* positions, int count, float* values)
+{
+	// Work through the batch in small chunks so the features stay in cache
+	float features[8 * MAX_TEAMS * featureCount];
+	for (int start = 0; start < count; start += 8)
+	{
+		int chunk = count - start < 8 ? count - start : 8;
+		extractFeatures(rules, &positions[start], chunk, features);
+
+		for (int i = 0; i < chunk * rules->teams; i++)
+		{
+			values[start * rules->teams + i] = evaluateFeatures(weights, &features[i * featureCount]);
+		}
+	}
+}
+
+int chooseMove(const Weights* weights, const Rules* rules, const Position* pos, int dieValue)
+{
+	int units[MAX_TEAM_SIZE];
+	int moveCount = generateMoves(rules, pos, dieValue, units);
+	if (moveCount == 0)
+	{
+		return -1;
+	}
+
+	// Evaluate every candidate in one batch and keep the best one for the mover
+	Position candidates[MAX_TEAM_SIZE];
+	for (int i = 0; i < moveCount; i++)
+	{
+		candidates[i] = *pos;
+		applyMove(rules, &candidates[i], units[i], dieValue, NULL);
+	}
+
+	float values[MAX_TEAM_SIZE * MAX_TEAMS];
+	evaluatePositions(weights, rules, candidates, moveCount, values);
+
+	int teams = rules->teams;
+	int best = 0;
+	for (int i = 1; i < moveCount; i++)
+	{
+		if (values[i * teams + pos->turn] > values[best * teams + pos->turn])
+		{
+			best = i;
+		}
+	}
+
+	return units[best];
+}
+
+#endif
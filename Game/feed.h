@@ -0,0 +1,257 @@
+#ifndef FEED_H
+#define FEED_H
+
+#include <SDL_stdinc.h>
+#include <rules.h>
+
+// Every this many updates the feed carries the full position again
+#define FEED_KEYFRAME_INTERVAL 32
+#define FEED_HEADER_SIZE 3
+#define FEED_UPDATE_MAX 96
+
+typedef struct FeedUpdate FeedUpdate;
+typedef struct FeedState FeedState;
+
+/*
+ * The spectator feed is a stream of updates. Each update starts with its
+ * total size and a sequence number, followed by records:
+ *   KEYFRAME turn progress[units]       full position
+ *   MOVE unit progress                  a unit moved
+ *   PROD unit                           a unit was sent back to its spawn
+ *   TURN team                           the turn passed on
+ *   ROLL team value                     a die was cast
+ *   END team                            the match was won
+ * A typical move is 10 bytes, against 21 for a keyframe of the standard board. Records set
+ * absolute values, so deltas following a keyframe that already contains
+ * them do no harm.
+ */
+typedef enum { FEED_KEYFRAME, FEED_MOVE, FEED_PROD, FEED_TURN, FEED_ROLL, FEED_END } FeedRecord;
+
+struct FeedUpdate
+{
+	Uint8 data[FEED_UPDATE_MAX];
+	int size;
+};
+
+/*
+ * What a spectator knows about the match. Updates are only applied on top
+ * of a keyframe, so a client that joins late or misses updates resyncs on
+ * the next keyframe.
+ */
+struct FeedState
+{
+	const Rules* rules;
+	Position position;
+	Uint16 sequence;
+	int synced;
+	int dieTeam;
+	int dieValue;
+	int rollCount;
+	int winner;
+};
+
+void beginFeedUpdate(FeedUpdate* update, Uint16 sequence);
+void feedKeyframe(FeedUpdate* update, const Rules* rules, const Position* pos);
+void prependKeyframe(FeedUpdate* update, const Rules* rules, const Position* pos);
+void feedMove(FeedUpdate* update, const MoveResult* move, int turn);
+void feedTurn(FeedUpdate* update, int turn);
+void feedRoll(FeedUpdate* update, int team, int value);
+void feedEnd(FeedUpdate* update, int team);
+void resetFeedState(FeedState* state, const Rules* rules);
+int applyFeedUpdate(FeedState* state, const Uint8* data, int size);
+
+void beginFeedUpdate(FeedUpdate* update, Uint16 sequence)
+{
+	update->data[0] = 0;
+	update->data[1] = (Uint8)(sequence >> 8);
+	update->data[2] = (Uint8)sequence;
+	update->size = FEED_HEADER_SIZE;
+}
+
+void feedKeyframe(FeedUpdate* update, const Rules* rules, const Position* pos)
+{
+	update->data[update->size++] = FEED_KEYFRAME;
+	update->data[update->size++] = pos->turn;
+	SDL_memcpy(&update->data[update->size], pos->progress, rules->units);
+	update->size += rules->units;
+	update->data[0] = (Uint8)update->size;
+}
+
+void prependKeyframe(FeedUpdate* update, const Rules* rules, const Position* pos)
+{
+	FeedUpdate keyframe;
+	beginFeedUpdate(&keyframe, (Uint16)((update->data[1] << 8) | update->data[2]));
+	feedKeyframe(&keyframe, rules, pos);
+
+	int deltaSize = update->size - FEED_HEADER_SIZE;
+	SDL_memcpy(&keyframe.data[keyframe.size], &update->data[FEED_HEADER_SIZE], deltaSize);
+	keyframe.size += deltaSize;
+	keyframe.data[0] = (Uint8)keyframe.size;
+
+	*update = keyframe;
+}
+
+void feedMove(FeedUpdate* update, const MoveResult* move, int turn)
+{
+	update->data[update->size++] = FEED_MOVE;
+	update->data[update->size++] = (Uint8)move->unit;
+	update->data[update->size++] = (Uint8)move->to;
+
+	if (move->proddedUnit >= 0)
+	{
+		update->data[update->size++] = FEED_PROD;
+		update->data[update->size++] = (Uint8)move->proddedUnit;
+	}
+
+	feedTurn(update, turn);
+}
+
+void feedTurn(FeedUpdate* update, int turn)
+{
+	update->data[update->size++] = FEED_TURN;
+	update->data[update->size++] = (Uint8)turn;
+	update->data[0] = (Uint8)update->size;
+}
+
+void feedRoll(FeedUpdate* update, int team, int value)
+{
+	update->data[update->size++] = FEED_ROLL;
+	update->data[update->size++] = (Uint8)team;
+	update->data[update->size++] = (Uint8)value;
+	update->data[0] = (Uint8)update->size;
+}
+
+void feedEnd(FeedUpdate* update, int team)
+{
+	update->data[update->size++] = FEED_END;
+	update->data[update->size++] = (Uint8)team;
+	update->data[0] = (Uint8)update->size;
+}
+
+void resetFeedState(FeedState* state, const Rules* rules)
+{
+	state->rules = rules;
+	resetPosition(&state->position);
+	state->sequence = 0;
+	state->synced = 0;
+	state->dieTeam = -1;
+	state->dieValue = 0;
+	state->rollCount = 0;
+	state->winner = -1;
+}
+
+// Size of the record at offset, type included, or -1 if it is cut off or holds a value the board has no place for
+static int feedRecordSize(const Rules* rules, const Uint8* data, int offset, int end)
+{
+	int type = data[offset];
+	int size = type == FEED_KEYFRAME ? 2 + rules->units : type == FEED_MOVE || type == FEED_ROLL ? 3 : type <= FEED_END ? 2 : 0;
+	if (size == 0 || offset + size > end)
+	{
+		return -1;
+	}
+
+	// Progress past the goal has no tile to stand on
+	const Uint8* record = &data[offset + 1];
+	if (type == FEED_KEYFRAME)
+	{
+		if (record[0] >= rules->teams)
+		{
+			return -1;
+		}
+		for (int i = 0; i < rules->units; i++)
+		{
+			if (record[1 + i] > rules->goal)
+			{
+				return -1;
+			}
+		}
+	}
+	else if ((type == FEED_MOVE && (record[0] >= rules->units || record[1] > rules->goal)) ||
+		(type == FEED_PROD && record[0] >= rules->units))
+	{
+		return -1;
+	}
+
+	return size;
+}
+
+/*
+ * Applies the update at the start of data. Returns the number of bytes
+ * used, 0 if the update is not complete yet or -1 if the data is corrupt.
+ * A corrupt update is rejected as a whole, the state is left untouched.
+ */
+int applyFeedUpdate(FeedState* state, const Uint8* data, int size)
+{
+	if (size < 1 || size < data[0])
+	{
+		return 0;
+	}
+
+	int end = data[0];
+	if (end < FEED_HEADER_SIZE)
+	{
+		return -1;
+	}
+
+	for (int offset = FEED_HEADER_SIZE; offset < end;)
+	{
+		int recordSize = feedRecordSize(state->rules, data, offset, end);
+		if (recordSize < 0)
+		{
+			return -1;
+		}
+		offset += recordSize;
+	}
+
+	// A gap in the sequence means updates were dropped, wait for the next keyframe
+	Uint16 sequence = (Uint16)((data[1] << 8) | data[2]);
+	if (state->synced && sequence != (Uint16)(state->sequence + 1))
+	{
+		state->synced = 0;
+	}
+	state->sequence = sequence;
+
+	for (int offset = FEED_HEADER_SIZE; offset < end; offset += feedRecordSize(state->rules, data, offset, end))
+	{
+		int type = data[offset];
+		const Uint8* record = &data[offset + 1];
+		if (type == FEED_KEYFRAME)
+		{
+			state->position.turn = record[0];
+			SDL_memcpy(state->position.progress, &record[1], state->rules->units);
+			state->synced = 1;
+			state->winner = -1;
+		}
+		// Until a keyframe arrives the deltas have nothing to apply to
+		else if (!state->synced)
+		{
+			continue;
+		}
+		else if (type == FEED_MOVE)
+		{
+			state->position.progress[record[0]] = record[1];
+		}
+		else if (type == FEED_PROD)
+		{
+			state->position.progress[record[0]] = PROGRESS_SPAWN;
+		}
+		else if (type == FEED_TURN)
+		{
+			state->position.turn = record[0] % state->rules->teams;
+		}
+		else if (type == FEED_ROLL)
+		{
+			state->dieTeam = record[0];
+			state->dieValue = record[1];
+			state->rollCount++;
+		}
+		else if (type == FEED_END)
+		{
+			state->winner = record[0];
+		}
+	}
+
+	return end;
+}
+
+#endif
@@ -4,9 +4,7 @@
 #include <stdlib.h>
 #include <SDL_pixels.h>
 #include <texture.h>
-
-#define teamSize 4
-#define nrOfTeams 4
+#include <rules.h>
 
 typedef struct Team Team;
 typedef struct Unit Unit;
@@ -42,9 +40,9 @@ struct Unit
 struct Team
 {
 	//Tile* start;
-	Tile* spawn[teamSize];
+	Tile* spawn[MAX_TEAM_SIZE];
 	Tile* finish;
-	Unit units[teamSize];
+	Unit units[MAX_TEAM_SIZE];
 	SDL_Rect playerClip;
 	char* name;
 };
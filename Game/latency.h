@@ -0,0 +1,167 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LATENCY_SAMPLES 4096
+#define MAX_PENDING_INPUTS 16
+
+// Safety margin kept between finishing a frame and the display refresh
+#define PACER_MARGIN_US 1500
+
+typedef struct LatencyStats LatencyStats;
+typedef struct FramePacer FramePacer;
+
+/*
+ * Input to photon latency: every key press is timestamped and matched with
+ * the present of the first frame rendered after it was handled. Keeps the
+ * most recent LATENCY_SAMPLES measurements in microseconds.
+ */
+struct LatencyStats
+{
+	Uint64 pending[MAX_PENDING_INPUTS];
+	int pendingCount;
+	Uint32 samples[LATENCY_SAMPLES];
+	int sampleCount;
+	int nextSample;
+};
+
+/*
+ * Starts each frame as late as the measured frame cost allows, so input is
+ * sampled right before the frame that shows it instead of a whole refresh
+ * earlier.
+ */
+struct FramePacer
+{
+	Uint64 period;
+	Uint64 lastPresent;
+	Uint64 workStart;
+	Uint64 workEstimate;
+};
+
+// Latency functions
+void resetLatencyStats(LatencyStats* stats);
+void markInput(LatencyStats* stats, const SDL_Event* e);
+void markPresent(LatencyStats* stats);
+void printLatencyReport(const LatencyStats* stats);
+void initFramePacer(FramePacer* pacer, SDL_Window* window);
+void waitForFrameStart(FramePacer* pacer);
+void finishFrame(FramePacer* pacer, SDL_Renderer* renderer);
+void markFramePresented(FramePacer* pacer);
+
+void resetLatencyStats(LatencyStats* stats)
+{
+	stats->pendingCount = 0;
+	stats->sampleCount = 0;
+	stats->nextSample = 0;
+}
+
+void markInput(LatencyStats* stats, const SDL_Event* e)
+{
+	if (e->type != SDL_KEYDOWN || e->key.repeat || stats->pendingCount == MAX_PENDING_INPUTS)
+	{
+		return;
+	}
+
+	// The event timestamp is in milliseconds, take the time it spent queued off the precise clock
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint32 queued = SDL_GetTicks() - e->key.timestamp;
+	stats->pending[stats->pendingCount++] = now - (Uint64)queued * SDL_GetPerformanceFrequency() / 1000;
+}
+
+void markPresent(LatencyStats* stats)
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+
+	for (int i = 0; i < stats->pendingCount; i++)
+	{
+		stats->samples[stats->nextSample] = (Uint32)((now - stats->pending[i]) * 1000000 / frequency);
+		stats->nextSample = (stats->nextSample + 1) % LATENCY_SAMPLES;
+		if (stats->sampleCount < LATENCY_SAMPLES)
+		{
+			stats->sampleCount++;
+		}
+	}
+
+	stats->pendingCount = 0;
+}
+
+static int compareSamples(const void* a, const void* b)
+{
+	Uint32 x = *(const Uint32*)a;
+	Uint32 y = *(const Uint32*)b;
+	return (x > y) - (x < y);
+}
+
+void printLatencyReport(const LatencyStats* stats)
+{
+	if (stats->sampleCount == 0)
+	{
+		printf("Input latency: no key presses measured.\n");
+		return;
+	}
+
+	Uint32 sorted[LATENCY_SAMPLES];
+	memcpy(sorted, stats->samples, stats->sampleCount * sizeof(Uint32));
+	qsort(sorted, stats->sampleCount, sizeof(Uint32), compareSamples);
+
+	int count = stats->sampleCount;
+	printf("Input latency over %d key presses: p50 %.1fms, p90 %.1fms, p99 %.1fms, max %.1fms\n", count,
+		sorted[count / 2] / 1000.0, sorted[count * 9 / 10] / 1000.0, sorted[count * 99 / 100] / 1000.0, sorted[count - 1] / 1000.0);
+}
+
+void initFramePacer(FramePacer* pacer, SDL_Window* window)
+{
+	SDL_DisplayMode mode;
+	int refreshRate = SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0 ? mode.refresh_rate : 60;
+
+	pacer->period = SDL_GetPerformanceFrequency() / refreshRate;
+	pacer->lastPresent = SDL_GetPerformanceCounter();
+	pacer->workStart = pacer->lastPresent;
+	pacer->workEstimate = pacer->period / 4;
+}
+
+void waitForFrameStart(FramePacer* pacer)
+{
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 margin = frequency * PACER_MARGIN_US / 1000000;
+	Uint64 budget = pacer->workEstimate + margin;
+	Uint64 deadline = pacer->lastPresent + (budget < pacer->period ? pacer->period - budget : 0);
+
+	// Sleep off most of the wait and spin the last millisecond, SDL_Delay is too coarse for the rest
+	Uint64 now = SDL_GetPerformanceCounter();
+	while (now < deadline)
+	{
+		Uint64 remainingMs = (deadline - now) * 1000 / frequency;
+		if (remainingMs > 1)
+		{
+			SDL_Delay((Uint32)(remainingMs - 1));
+		}
+		now = SDL_GetPerformanceCounter();
+	}
+
+	pacer->workStart = now;
+}
+
+void finishFrame(FramePacer* pacer, SDL_Renderer* renderer)
+{
+	// Reading back a pixel waits for the GPU, so frames never queue up behind the present
+	Uint32 pixel;
+	SDL_Rect rect = { 0, 0, 1, 1 };
+	SDL_RenderReadPixels(renderer, &rect, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel));
+
+	// Track the slowest recent frames quickly and let the estimate come down slowly
+	Uint64 work = SDL_GetPerformanceCounter() - pacer->workStart;
+	pacer->workEstimate = work > pacer->workEstimate ? work : (pacer->workEstimate * 15 + work) / 16;
+}
+
+void markFramePresented(FramePacer* pacer)
+{
+	pacer->lastPresent = SDL_GetPerformanceCounter();
+}
+
+#endif
@@ -1,3 +1,4 @@
+#define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <time.h>
 #include <stdlib.h>
@@ -8,45 +9,91 @@
 #include <string.h>
 #include <texture.h>
 #include <gameObjects.h>
+#include <rules.h>
+#include <evaluator.h>
+#include <spectator.h>
+#include <arena.h>
+#include <board.h>
+#include <boardview.h>
+#include <scene.h>
+#include <latency.h>
+#include <wall.h>
 
 typedef enum { ROLL, MOVE } GamePhase;
-#define tilesSize 48
+#define GAME_MSG_SIZE 128
+// How fast the selected unit marker fades, it wraps around about once a second
+#define MARKER_PULSE_STEP 4
 
 /* Variables */
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 const int BOARD_WIDTH = 400;
 const int BOARD_HEIGHT = 400;
-const SDL_Color RED = { 0xEE, 0x11, 0x11, 0xFF };
-const SDL_Color GREEN = { 0x00, 0xAA, 0x22, 0xFF };
-const SDL_Color BLUE = { 0x00, 0x44, 0xFF, 0xFF };
-const SDL_Color YELLOW = { 0xFF, 0xDD, 0x00, 0xFF };
-const SDL_Color BACKGROUND_WHITE = { 0xFA, 0xFA, 0xF0, 0xFF };
-const int playerWidth = 15;
-const int playerHeight = 23;
 
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
 TTF_Font* font;
 
-void(*renderHandler)();
-int(*eventHandler)(SDL_Event*);
-void(*unloadHandler)();
-
 /* Funcion declarations */
 int init();
 void close();
 
-int loadMainMenu();
+int loadMainMenu(Arena* arena);
 void renderMainMenu();
 int handleMainMenuEvent(SDL_Event* e);
-void unloadMainMenu();
 
-int loadGame();
+int loadGame(Arena* arena);
+void updateGame();
 void renderGame();
 int handleGameEvent(SDL_Event* e);
-void unloadGame();
 void setGamePhase(GamePhase p);
+void syncUnits();
+void startRoll();
+void moveSelectedUnit();
+void skipTurn();
+void playAiTurn();
+
+int loadPauseMenu(Arena* arena);
+void renderPauseMenu();
+int handlePauseMenuEvent(SDL_Event* e);
+
+int loadSpectator(Arena* arena);
+void updateSpectator();
+int handleSpectatorEvent(SDL_Event* e);
+void unloadSpectator();
+void setSpectatorMessage();
+
+int loadWall(Arena* arena);
+void updateWall();
+void renderWall();
+int handleWallEvent(SDL_Event* e);
+void unloadWall();
+
+// Key press to present timing, --low-latency also paces the frames for it
+int lowLatency = 0;
+LatencyStats latency;
+FramePacer pacer;
+
+// Board variant to play, --board on the command line
+BoardDescription boardDescription;
+
+// Match to watch when started with --spectate
+const char* spectatedHost;
+int spectatedPort;
+Uint32 spectatedMatch;
+// Replay file the watched match is saved to, --record on the command line
+const char* recordPath = NULL;
+
+// Games shown with --wall and how fast they are played
+int wallBoards = DEFAULT_WALL_BOARDS;
+int wallTurnMs = DEFAULT_WALL_TURN_MS;
+
+/* Scenes */
+Scene mainMenuScene = { .load = &loadMainMenu, .update = NULL, .render = &renderMainMenu, .handleEvent = &handleMainMenuEvent, .unload = NULL, .overlay = 0 };
+Scene gameScene = { .load = &loadGame, .update = &updateGame, .render = &renderGame, .handleEvent = &handleGameEvent, .unload = NULL, .overlay = 0 };
+Scene pauseScene = { .load = &loadPauseMenu, .update = NULL, .render = &renderPauseMenu, .handleEvent = &handlePauseMenuEvent, .unload = NULL, .overlay = 1 };
+Scene spectatorScene = { .load = &loadSpectator, .update = &updateSpectator, .render = &renderGame, .handleEvent = &handleSpectatorEvent, .unload = &unloadSpectator, .overlay = 0 };
+Scene wallScene = { .load = &loadWall, .update = &updateWall, .render = &renderWall, .handleEvent = &handleWallEvent, .unload = &unloadWall, .overlay = 0 };
 
 /* Function definitions */
 int init()
@@ -111,7 +158,13 @@ int init()
 
 void close()
 {
-	unloadHandler();
+	closeScene(&wallScene);
+	closeScene(&spectatorScene);
+	closeScene(&pauseScene);
+	closeScene(&gameScene);
+	closeScene(&mainMenuScene);
+
+	printLatencyReport(&latency);
 
 	TTF_CloseFont(font);
 	font = NULL;
@@ -128,8 +181,54 @@ void close()
 	SDL_Quit();
 }
 
+// The benchmark builds this file too and brings its own main
+#ifndef FIA_NO_MAIN
+static int isOptionValue(int argc, char* args[], int i)
+{
+	return i < argc && strncmp(args[i], "--", 2) != 0;
+}
+
 int main(int argc, char* args[])
 {
+	// Fia.exe --spectate host [port] [match] watches a match on a server, --record replay.bin saves it
+	// Fia.exe --wall [boards] [ms per turn] watches AI games on a grid of boards
+	// Fia.exe --board teams [team size] [ring size] [finish size] plays another variant
+	// --low-latency and --record may go anywhere, an option only takes the values up to the next flag
+	int spectate = 0;
+	int showWall = 0;
+	standardBoard(&boardDescription, BOARD_WIDTH, BOARD_HEIGHT);
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--spectate") == 0 && isOptionValue(argc, args, i + 1))
+		{
+			spectate = 1;
+			spectatedHost = args[++i];
+			spectatedPort = isOptionValue(argc, args, i + 1) ? atoi(args[++i]) : SERVER_PORT;
+			spectatedMatch = isOptionValue(argc, args, i + 1) ? (Uint32)atoi(args[++i]) : 0;
+		}
+		else if (strcmp(args[i], "--wall") == 0)
+		{
+			showWall = 1;
+			wallBoards = isOptionValue(argc, args, i + 1) ? atoi(args[++i]) : wallBoards;
+			wallTurnMs = isOptionValue(argc, args, i + 1) ? atoi(args[++i]) : wallTurnMs;
+		}
+		else if (strcmp(args[i], "--board") == 0 && isOptionValue(argc, args, i + 1))
+		{
+			boardDescription.teams = atoi(args[++i]);
+			boardDescription.teamSize = isOptionValue(argc, args, i + 1) ? atoi(args[++i]) : boardDescription.teamSize;
+			boardDescription.ringSize = isOptionValue(argc, args, i + 1) ? atoi(args[++i]) : boardDescription.ringSize;
+			boardDescription.finishSize = isOptionValue(argc, args, i + 1) ? atoi(args[++i]) : boardDescription.finishSize;
+		}
+		else if (strcmp(args[i], "--low-latency") == 0)
+		{
+			lowLatency = 1;
+		}
+		else if (strcmp(args[i], "--record") == 0 && isOptionValue(argc, args, i + 1))
+		{
+			recordPath = args[++i];
+		}
+	}
+
 	//Start up SDL and create window
 	if (!init())
 	{
@@ -143,7 +242,15 @@ int main(int argc, char* args[])
 		{
 			printf("Failed to load font! SDL_ttf Error: %s\n", TTF_GetError());
 		}
-		else if (!loadMainMenu())
+		else if (spectate && !pushScene(&spectatorScene))
+		{
+			printf("Failed to start spectating!\n");
+		}
+		else if (showWall && !pushScene(&wallScene))
+		{
+			printf("Failed to start the wall!\n");
+		}
+		else if (!spectate && !showWall && !pushScene(&mainMenuScene))
 		{
 			printf("Failed to load main menu!\n");
 		}
@@ -153,6 +260,9 @@ int main(int argc, char* args[])
 			srand(time(NULL));
 			SDL_Event e;
 
+			resetLatencyStats(&latency);
+			initFramePacer(&pacer, window);
+
 			// Game loop
 			int quit = 0;
 			while (!quit)
@@ -160,6 +270,12 @@ int main(int argc, char* args[])
 				//The rerender text flag
 				int renderText = 0;
 
+				//Sample input as late as the frame allows
+				if (lowLatency)
+				{
+					waitForFrameStart(&pacer);
+				}
+
 				//Handle events on queue
 				while (SDL_PollEvent(&e) != 0)
 				{
@@ -170,8 +286,10 @@ int main(int argc, char* args[])
 					}
 					else
 					{
+						markInput(&latency, &e);
+
 						// Handle event, if it fails quit application
-						if (!eventHandler(&e))
+						if (!handleSceneEvent(&e))
 						{
 							quit = 1;
 							printf("Failed to handle event!\n");
@@ -185,10 +303,17 @@ int main(int argc, char* args[])
 					SDL_SetRenderDrawColor(renderer, BACKGROUND_WHITE.r, BACKGROUND_WHITE.g, BACKGROUND_WHITE.b, BACKGROUND_WHITE.a);
 					SDL_RenderClear(renderer);
 
-					renderHandler();
+					updateScenes();
+					renderScenes();
 
 					//Update screen
+					if (lowLatency)
+					{
+						finishFrame(&pacer, renderer);
+					}
 					SDL_RenderPresent(renderer);
+					markPresent(&latency);
+					markFramePresented(&pacer);
 				}
 			}
 		}
@@ -199,34 +324,30 @@ int main(int argc, char* args[])
 
 	return 0;
 }
+#endif
 
 /***** MAIN MENU *****/
 Texture* background;
-int loadMainMenu()
+int loadMainMenu(Arena* arena)
 {
 	int success = 1;
 
-	background = (Texture*)malloc(sizeof(Texture));
-	*background = (Texture){ .height = 0, .width = 0, .texture = NULL };
-	if (!loadTextureFromFile(background, renderer, "background.png"))
+	background = arenaTexture(arena);
+	if (background == NULL || !loadTextureFromFile(background, renderer, "background.png"))
 	{
 		printf("Failed to load texture image!\n");
 		success = 0;
 	}
 
-	renderHandler = &renderMainMenu;
-	eventHandler = &handleMainMenuEvent;
-	unloadHandler = &unloadMainMenu;
+	// Get the game ready while the menu is shown, so starting it is instant
+	if (success && (!loadScene(&gameScene) || !loadScene(&pauseScene)))
+	{
+		printf("Failed to preload game!\n");
+	}
 
 	return success;
 }
 
-void unloadMainMenu()
-{
-	freeTexture(background);
-	free(background);
-}
-
 void renderMainMenu()
 {
 	renderTexture(background, renderer, 0, 0, NULL, 0, NULL, SDL_FLIP_NONE);
@@ -240,8 +361,7 @@ int handleMainMenuEvent(SDL_Event* e)
 	{
 		if (e->key.keysym.sym == SDLK_RETURN)
 		{
-			unloadHandler();
-			if (!loadGame()) {
+			if (!setScene(&gameScene)) {
 				printf("Failed to load game!\n");
 				success = 0;
 			}
@@ -253,32 +373,44 @@ int handleMainMenuEvent(SDL_Event* e)
 
 /***** GAME *****/
 Texture* gameMsgTexture;
+char* gameMsg;
 Texture* playersSprite;
 Die* die;
-Tile tiles[tilesSize];
-Team teams[4];
+Layout layout;
+const Rules* rules = &layout.rules;
+BoardView board;
 int turn = 0;
 GamePhase phase = ROLL;
 int selectedUnitIndex;
 int pauseInput = 0;
-int outerRingSize = 24;
+Position position;
+Weights aiWeights;
+int aiSeats[MAX_TEAMS];
 
 // TODO: a list of animations that are worked through during game render
-// TODO: pointer
-DieAnimation dieAnimation;
-int loadGame()
+DieAnimation* dieAnimation;
+int loadGame(Arena* arena)
 {
 	int success = 1;
 
-	playersSprite = (Texture*)malloc(sizeof(Texture));
-	*playersSprite = (Texture){ .height = 0, .width = 0, .texture = NULL };
-	if (!loadTextureFromFile(playersSprite, renderer, "players.png"))
+	/* Scene objects, all owned by the scene arena */
+	playersSprite = arenaTexture(arena);
+	gameMsgTexture = arenaTexture(arena);
+	gameMsg = (char*)arenaAlloc(arena, GAME_MSG_SIZE);
+	die = (Die*)arenaAlloc(arena, sizeof(Die));
+	dieAnimation = (DieAnimation*)arenaAlloc(arena, sizeof(DieAnimation));
+	if (playersSprite == NULL || gameMsgTexture == NULL || gameMsg == NULL || die == NULL || dieAnimation == NULL || !trackTexture(arena, &die->texture))
+	{
+		// Without its objects the scene cannot even be rendered
+		return 0;
+	}
+
+	if (!loadPlayersSprite(playersSprite, renderer, "players.png"))
 	{
 		printf("Failed to load texture image!\n");
 		success = 0;
 	}
 
-	die = (Die*)malloc(sizeof(Die));
 	*die = (Die) { .sides = 6, .currentValue = 0 };
 	die->clip = (SDL_Rect){ .w = 46, .h = 46, .x = 0, .y = 0 };
 	if (!loadTextureFromFile(&(die->texture), renderer, "die.png"))
@@ -287,179 +419,58 @@ int loadGame()
 		success = 0;
 	}
 
-	dieAnimation = (DieAnimation){ .remainingFrames = -1, .die = NULL };
-
-	int radiusSmall = 46;
-	int radiusBig = 100;
-	int spacing = 13;
-
-	int boardLeft = (SCREEN_WIDTH - BOARD_WIDTH) / 2;
-	int boardTop = (SCREEN_HEIGHT - BOARD_HEIGHT) / 2;
-
-	/* Spawn */
-	tiles[37] = (Tile){ .nextTile = &tiles[0], .posX = boardLeft, .posY = boardTop + BOARD_HEIGHT - radiusSmall - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[37].color = RED;
-	tiles[38] = (Tile){ .nextTile = &tiles[0], .posX = boardLeft + radiusSmall, .posY = boardTop + BOARD_HEIGHT - radiusSmall - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[38].color = RED;
-	tiles[32] = (Tile){ .nextTile = &tiles[0], .posX = boardLeft, .posY = boardTop + BOARD_HEIGHT - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[32].color = RED;
-	tiles[36] = (Tile){ .nextTile = &tiles[0], .posX = boardLeft + radiusSmall, .posY = boardTop + BOARD_HEIGHT - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[36].color = RED;
-
-	tiles[33] = (Tile){ .nextTile = &tiles[6], .posX = boardLeft, .posY = boardTop, .radius = radiusSmall, .type = SPAWN };
-	tiles[33].color = GREEN;
-	tiles[39] = (Tile){ .nextTile = &tiles[6], .posX = boardLeft + radiusSmall, .posY = boardTop, .radius = radiusSmall, .type = SPAWN };
-	tiles[39].color = GREEN;
-	tiles[40] = (Tile){ .nextTile = &tiles[6], .posX = boardLeft, .posY = boardTop + radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[40].color = GREEN;
-	tiles[41] = (Tile){ .nextTile = &tiles[6], .posX = boardLeft + radiusSmall, .posY = boardTop + radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[41].color = GREEN;
-
-	tiles[34] = (Tile){ .nextTile = &tiles[12], .posX = boardLeft + BOARD_WIDTH - radiusSmall, .posY = boardTop, .radius = radiusSmall, .type = SPAWN };
-	tiles[34].color = BLUE;
-	tiles[42] = (Tile){ .nextTile = &tiles[12], .posX = boardLeft + BOARD_WIDTH - radiusSmall, .posY = boardTop + radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[42].color = BLUE;
-	tiles[43] = (Tile){ .nextTile = &tiles[12], .posX = boardLeft + BOARD_WIDTH - radiusSmall - radiusSmall, .posY = boardTop, .radius = radiusSmall, .type = SPAWN };
-	tiles[43].color = BLUE;
-	tiles[44] = (Tile){ .nextTile = &tiles[12], .posX = boardLeft + BOARD_WIDTH - radiusSmall - radiusSmall, .posY = boardTop + radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[44].color = BLUE;
-
-	tiles[35] = (Tile) { .nextTile = &tiles[18], .posX = boardLeft + BOARD_WIDTH - radiusSmall, .posY = boardTop + BOARD_HEIGHT - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[35].color = YELLOW;
-	tiles[45] = (Tile){ .nextTile = &tiles[18], .posX = boardLeft + BOARD_WIDTH - radiusSmall - radiusSmall, .posY = boardTop + BOARD_HEIGHT - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[45].color = YELLOW;
-	tiles[46] = (Tile){ .nextTile = &tiles[18], .posX = boardLeft + BOARD_WIDTH - radiusSmall, .posY = boardTop + BOARD_HEIGHT - radiusSmall - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[46].color = YELLOW;
-	tiles[47] = (Tile){ .nextTile = &tiles[18], .posX = boardLeft + BOARD_WIDTH - radiusSmall - radiusSmall, .posY = boardTop + BOARD_HEIGHT - radiusSmall - radiusSmall, .radius = radiusSmall, .type = SPAWN };
-	tiles[47].color = YELLOW;
-
-	/* Outer ring */
-	tiles[0] = (Tile){ .nextTile = &tiles[1], .posX = boardLeft + 2 * radiusSmall + 2 * spacing, .posY = boardTop + 6 * radiusSmall + 6 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[0].color = RED;
-	tiles[1] = (Tile){ .nextTile = &tiles[2], .posX = boardLeft + 2 * radiusSmall + 2 * spacing, .posY = boardTop + 5 * radiusSmall + 5 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[1].color = GREEN;
-	tiles[2] = (Tile){ .nextTile = &tiles[3], .posX = boardLeft + 2 * radiusSmall + 2 * spacing, .posY = boardTop + 4 * radiusSmall + 4 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[2].color = BLUE;
-	tiles[3] = (Tile){ .nextTile = &tiles[4], .posX = boardLeft + 1 * radiusSmall + 1 * spacing, .posY = boardTop + 4 * radiusSmall + 4 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[3].color = YELLOW;
-	tiles[4] = (Tile){ .nextTile = &tiles[5], .posX = boardLeft, .posY = boardTop + 4 * radiusSmall + 4 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[4].color = RED;
-	tiles[5] = (Tile){ .nextTile = &tiles[6], .posX = boardLeft, .posY = boardTop + 3 * radiusSmall + 3 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[5].color = GREEN;
-	tiles[6] = (Tile){ .nextTile = &tiles[7], .posX = boardLeft, .posY = boardTop + 2 * radiusSmall + 2 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[6].color = GREEN;
-	tiles[7] = (Tile){ .nextTile = &tiles[8], .posX = boardLeft + 1 * radiusSmall + 1 * spacing, .posY = boardTop + 2 * radiusSmall + 2 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[7].color = BLUE;
-	tiles[8] = (Tile){ .nextTile = &tiles[9], .posX = boardLeft + 2 * radiusSmall + 2 * spacing, .posY = boardTop + 2 * radiusSmall + 2 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[8].color = YELLOW;
-	tiles[9] = (Tile){ .nextTile = &tiles[10], .posX = boardLeft + 2 * radiusSmall + 2 * spacing, .posY = boardTop + 1 * radiusSmall + 1 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[9].color = RED;
-	tiles[10] = (Tile){ .nextTile = &tiles[11], .posX = boardLeft + 2 * radiusSmall + 2 * spacing, .posY = boardTop + 0 * radiusSmall + 0 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[10].color = GREEN;
-	tiles[11] = (Tile){ .nextTile = &tiles[12], .posX = boardLeft + 3 * radiusSmall + 3 * spacing, .posY = boardTop + 0 * radiusSmall + 0 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[11].color = BLUE;
-	tiles[12] = (Tile){ .nextTile = &tiles[13], .posX = boardLeft + 4 * radiusSmall + 4 * spacing, .posY = boardTop + 0 * radiusSmall + 0 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[12].color = BLUE;
-	tiles[13] = (Tile){ .nextTile = &tiles[14], .posX = boardLeft + 4 * radiusSmall + 4 * spacing, .posY = boardTop + 1 * radiusSmall + 1 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[13].color = YELLOW;
-	tiles[14] = (Tile){ .nextTile = &tiles[15], .posX = boardLeft + 4 * radiusSmall + 4 * spacing, .posY = boardTop + 2 * radiusSmall + 2 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[14].color = RED;
-	tiles[15] = (Tile){ .nextTile = &tiles[16], .posX = boardLeft + 5 * radiusSmall + 5 * spacing, .posY = boardTop + 2 * radiusSmall + 2 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[15].color = GREEN;
-	tiles[16] = (Tile){ .nextTile = &tiles[17], .posX = boardLeft + 6 * radiusSmall + 6 * spacing, .posY = boardTop + 2 * radiusSmall + 2 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[16].color = BLUE;
-	tiles[17] = (Tile){ .nextTile = &tiles[18], .posX = boardLeft + 6 * radiusSmall + 6 * spacing, .posY = boardTop + 3 * radiusSmall + 3 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[17].color = YELLOW;
-	tiles[18] = (Tile){ .nextTile = &tiles[19], .posX = boardLeft + 6 * radiusSmall + 6 * spacing, .posY = boardTop + 4 * radiusSmall + 4 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[18].color = YELLOW;
-	tiles[19] = (Tile){ .nextTile = &tiles[20], .posX = boardLeft + 5 * radiusSmall + 5 * spacing, .posY = boardTop + 4 * radiusSmall + 4 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[19].color = RED;
-	tiles[20] = (Tile){ .nextTile = &tiles[21], .posX = boardLeft + 4 * radiusSmall + 4 * spacing, .posY = boardTop + 4 * radiusSmall + 4 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[20].color = GREEN;
-	tiles[21] = (Tile){ .nextTile = &tiles[22], .posX = boardLeft + 4 * radiusSmall + 4 * spacing, .posY = boardTop + 5 * radiusSmall + 5 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[21].color = BLUE;
-	tiles[22] = (Tile){ .nextTile = &tiles[23], .posX = boardLeft + 4 * radiusSmall + 4 * spacing, .posY = boardTop + 6 * radiusSmall + 6 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[22].color = YELLOW;
-	tiles[23] = (Tile){ .nextTile = &tiles[0], .posX = boardLeft + 3 * radiusSmall + 3 * spacing, .posY = boardTop + 6 * radiusSmall + 6 * spacing, .radius = radiusSmall, .type = RING, .unit = NULL };
-	tiles[23].color = RED;
-
-	/* Finish tiles */
-	tiles[24] = (Tile){ .nextTile = &tiles[25], .posX = boardLeft + 3 * radiusSmall + 3 * spacing, .posY = boardTop + 5 * radiusSmall + 5 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[24].color = RED;
-	tiles[25] = (Tile){ .nextTile = NULL, .posX = boardLeft + 3 * radiusSmall + 3 * spacing, .posY = boardTop + 4 * radiusSmall + 4 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[25].color = RED;
-	tiles[26] = (Tile){ .nextTile = &tiles[27], .posX = boardLeft + 1 * radiusSmall + 1 * spacing, .posY = boardTop + 3 * radiusSmall + 3 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[26].color = GREEN;
-	tiles[27] = (Tile){ .nextTile = NULL, .posX = boardLeft + 2 * radiusSmall + 2 * spacing, .posY = boardTop + 3 * radiusSmall + 3 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[27].color = GREEN;
-	tiles[28] = (Tile){ .nextTile = &tiles[29], .posX = boardLeft + 3 * radiusSmall + 3 * spacing, .posY = boardTop + 1 * radiusSmall + 1 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[28].color = BLUE;
-	tiles[29] = (Tile) { .nextTile = NULL, .posX = boardLeft + 3 * radiusSmall + 3 * spacing, .posY = boardTop + 2 * radiusSmall + 2 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[29].color = BLUE;
-	tiles[30] = (Tile) { .nextTile = &tiles[31], .posX = boardLeft + 5 * radiusSmall + 5 * spacing, .posY = boardTop + 3 * radiusSmall + 3 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[30].color = YELLOW;
-	tiles[31] = (Tile) { .nextTile = NULL, .posX = boardLeft + 4 * radiusSmall + 4 * spacing, .posY = boardTop + 3 * radiusSmall + 3 * spacing, .radius = radiusSmall, .type = FINISH, .unit = NULL };
-	tiles[31].color = YELLOW;
-
-	/* Teams */
-	teams[0] = (Team){ .finish = &tiles[24], .name = "Red" };
-	teams[0].spawn[0] = &tiles[37];
-	teams[0].spawn[1] = &tiles[38];
-	teams[0].spawn[2] = &tiles[32];
-	teams[0].spawn[3] = &tiles[36];
-	teams[0].playerClip = (SDL_Rect){ .x = 0, .y = 0, .w = playerWidth, .h = playerHeight };
-
-	teams[1] = (Team){ .finish = &tiles[26], .name = "Green" };
-	teams[1].spawn[0] = &tiles[33];
-	teams[1].spawn[1] = &tiles[39];
-	teams[1].spawn[2] = &tiles[40];
-	teams[1].spawn[3] = &tiles[41];
-	teams[1].playerClip = (SDL_Rect) { .x = playerWidth, .y = 0, .w = playerWidth, .h = playerHeight };
-
-	teams[2] = (Team){ .finish = &tiles[28], .name = "Blue" };
-	teams[2].spawn[0] = &tiles[43];
-	teams[2].spawn[1] = &tiles[34];
-	teams[2].spawn[2] = &tiles[44];
-	teams[2].spawn[3] = &tiles[42];
-	teams[2].playerClip = (SDL_Rect){ .x = 0, .y = playerHeight, .w = playerWidth, .h = playerHeight };
-	
-	teams[3] = (Team){ .finish = &tiles[30], .name = "Yellow" };
-	teams[3].spawn[0] = &tiles[47];
-	teams[3].spawn[1] = &tiles[46];
-	teams[3].spawn[2] = &tiles[45];
-	teams[3].spawn[3] = &tiles[35];
-	teams[3].playerClip = (SDL_Rect){ .x = playerWidth, .y = playerHeight, .w = playerWidth, .h = playerHeight };
-
-	for (int i = 0; i < nrOfTeams; i++)
-	{
-		for (int j = 0; j < teamSize; j++)
-		{
-			teams[i].units[j] = (Unit){ .team = &teams[i], .position = teams[i].spawn[j], .finished = 0 };
-			teams[i].units[j].position->unit = &teams[i].units[j];
-		}
+	*dieAnimation = (DieAnimation){ .remainingFrames = -1, .die = NULL };
+
+	/* Board, generated once per variant and cached on disk */
+	if (!prepareLayout(&layout, &boardDescription))
+	{
+		return 0;
 	}
 
-	gameMsgTexture = (Texture*)malloc(sizeof(Texture));
-	*gameMsgTexture = (Texture){ .height = 0, .width = 0, .texture = NULL };
-	
-	turn = 0;
-	setGamePhase(ROLL);
+	int boardLeft = (SCREEN_WIDTH - boardDescription.width) / 2;
+	int boardTop = (SCREEN_HEIGHT - boardDescription.height) / 2;
+
+	setupBoardView(&board, &layout, boardLeft, boardTop);
 
-	renderHandler = &renderGame;
-	eventHandler = &handleGameEvent;
-	unloadHandler = &unloadGame;
+	/* Every seat starts out played by hand */
+	for (int i = 0; i < rules->teams; i++)
+	{
+		aiSeats[i] = 0;
+	}
+
+	// Fall back to the built in weights if no trained weights are around
+	if (!loadWeights(&aiWeights, "weights.bin"))
+	{
+		defaultWeights(&aiWeights);
+	}
+
+	resetPosition(&position);
+	syncUnits();
+
+	turn = position.turn;
+	pauseInput = 0;
+	setGamePhase(ROLL);
 
 	return success;
 }
 
-void unloadGame()
+void updateGame()
 {
-	freeTexture(playersSprite);
-	free(playersSprite);
-	freeTexture(gameMsgTexture);
-	free(gameMsgTexture);
-	freeTexture(&(die->texture));
-	free(die);
+	/* Let the AI play its seats */
+	if (aiSeats[turn] && !pauseInput)
+	{
+		playAiTurn();
+	}
+
+	/* Animations */
+	if (dieAnimation->remainingFrames >= 0)
+	{
+		if (dieAnimation->remainingFrames == 0) {
+			pauseInput = 0;
+		}
+
+		dieAnimation->remainingFrames--;
+	}
 }
 
 Uint8 selectedColor = 0xFF;
@@ -468,60 +479,25 @@ void renderGame()
 	/* Render game message */
 	renderTexture(gameMsgTexture, renderer, 10, 10, NULL, 0, NULL, SDL_FLIP_NONE);
 
-	/* Render tiles */
-	for (int i = 0; i < tilesSize; i++)
-	{
-		SDL_Rect tile = { tiles[i].posX, tiles[i].posY, tiles[i].radius, tiles[i].radius };
-		SDL_SetRenderDrawColor(renderer, tiles[i].color.r, tiles[i].color.g, tiles[i].color.b, tiles[i].color.a);
-		SDL_RenderFillRect(renderer, &tile);
-	}
+	renderBoard(&board, renderer, playersSprite);
 
-	/* Render sprites */
-	for (int i = 0; i < nrOfTeams; i++)
+	// render the selected unit marker
+	Unit* selected = &board.teams[turn].units[selectedUnitIndex];
+	if (!selected->finished && selected->position != NULL)
 	{
-		for (int j = 0; j < teamSize; j++)
-		{
-			Unit* unit = &teams[i].units[j];
-
-			if (!unit->finished)
-			{
-				int posX = (unit->position->posX + (unit->position->radius / 2)) - (playerWidth / 2);
-				int posY = (unit->position->posY + (unit->position->radius / 2)) - (playerHeight / 2);
-				renderTexture(playersSprite, renderer, posX, posY, &teams[i].playerClip, 0, NULL, SDL_FLIP_NONE);
-			}
-		}
-
-		// render the selected unit marker
+		SDL_Rect rect = { selected->position->posX + ((selected->position->radius / 2) - 10 / 2), selected->position->posY, 10, 10 };
 		SDL_SetRenderDrawColor(renderer, selectedColor, selectedColor, selectedColor, 0xFF);
-		if (!teams[turn].units[selectedUnitIndex].finished)
-		{
-			SDL_Rect rect =
-			{
-				teams[turn].units[selectedUnitIndex].position->posX + (((teams[turn].units[selectedUnitIndex].position->radius) / 2) - 10 / 2),
-				teams[turn].units[selectedUnitIndex].position->posY, 10, 10
-			};
-			SDL_RenderFillRect(renderer, &rect);
-			if (selectedColor == 0) {
-				selectedColor = 0xFF;
-			}
-			else {
-				selectedColor--;
-			}
-		}
+		SDL_RenderFillRect(renderer, &rect);
+		selectedColor = selectedColor < MARKER_PULSE_STEP ? 0xFF : selectedColor - MARKER_PULSE_STEP;
 	}
 
 	/* Animations */
-	if (dieAnimation.remainingFrames >= 0)
+	if (dieAnimation->remainingFrames >= 0)
 	{
 		int w = die->clip.w;
-		int x = (dieAnimation.remainingFrames * w) % (6 * w);
+		int x = (dieAnimation->remainingFrames * w) % (6 * w);
 		SDL_Rect clip = (SDL_Rect){ .x = x, .y = 0, .w = w, .h = die->clip.h };
 		renderTexture(&die->texture, renderer, 50, 50, &clip, 0, NULL, SDL_FLIP_NONE);
-		if (dieAnimation.remainingFrames == 0) {
-			pauseInput = 0;
-		}
-		
-		dieAnimation.remainingFrames--;
 	}
 	else if (phase == MOVE) {
 		renderTexture(&die->texture, renderer, 50, 50, &die->clip, 0, NULL, SDL_FLIP_NONE);
@@ -533,13 +509,12 @@ int handleGameEvent(SDL_Event* e)
 	int success = 1;
 	if (e->type == SDL_KEYDOWN)
 	{
-		// quit to main menu
+		// pause, the match stays as it is underneath the menu
 		if (e->key.keysym.sym == SDLK_ESCAPE)
 		{
-			unloadGame();
-			if (!loadMainMenu())
+			if (!pushScene(&pauseScene))
 			{
-				printf("Failed to load main menu!\n");
+				printf("Failed to load pause menu!\n");
 				success = 0;
 			}
 		}
@@ -549,144 +524,33 @@ int handleGameEvent(SDL_Event* e)
 			{
 				if (e->key.keysym.sym == SDLK_SPACE)
 				{
-					castDie(die);
-					//dieAnimation.die = die;
-
-					// TODO: why is this not 1 sec???
-					dieAnimation.remainingFrames = 60;
-					pauseInput = 1;
-					setGamePhase(MOVE);
+					startRoll();
+				}
+				else if (e->key.keysym.sym == SDLK_a)
+				{
+					// hand the current team over to the AI
+					aiSeats[turn] = 1;
 				}
 			}
 			else if (phase == MOVE)
 			{
 				if (e->key.keysym.sym == SDLK_RETURN)
 				{
-					Unit* currentUnit = &teams[turn].units[selectedUnitIndex];
-					int dieValue = die->currentValue;
-
- 					// move player
-					if ((currentUnit->position->type == SPAWN && (dieValue == 1 || dieValue == 6)) ||
-							currentUnit->position->type != SPAWN)
-					{
-						int moveLegal = 0;
-						Tile* origPos = currentUnit->position;
-
-						// TODO: have to finish on the finish tile
-						for (int i = 0; i < dieValue; i++) 
-						{
-							int isNotInSpawn = 1;
-
-							for (int j = 0; j < teamSize; j++)
-							{
-								if (currentUnit->team->spawn[j] == currentUnit->position)
-								{
-									isNotInSpawn = 0;
-									j = teamSize;
-								}
-							}
-
-							int b = 1;
-							// if the next tile is next from spawn, means go to finish stretch
-							if (currentUnit->position != NULL)
-							{
-								if (currentUnit->position->nextTile == currentUnit->team->spawn[0]->nextTile && isNotInSpawn)
-								{
-									currentUnit->position = currentUnit->team->finish;
-									b = 0;
-								}
-							}
-							
-							if (b)
-							{
-								if (currentUnit->position == NULL)
-								{
-									currentUnit->position = currentUnit->team->finish->nextTile;
-								}
-								else
-								{
-									// move to next tile
-									currentUnit->position = currentUnit->position->nextTile;
-								}
-
-								int isLastStep = i == (dieValue - 1);
-								if (currentUnit->position == NULL && isLastStep)
-								{
-									currentUnit->finished = 1;
-								}
-							}
-						}
-
-						if (currentUnit->finished)
-						{
-							origPos->unit = NULL;
-							turn = (turn + 1) % nrOfTeams;
-							setGamePhase(ROLL);
-							
-							return 1;
-						}
-
-						// if tile was empty
-						if (currentUnit->position->unit == NULL)
-						{
-							moveLegal = 1;
-						}
-						else 
-						{
-							// if tile is occupied by team member
-							if (strcmp(currentUnit->position->unit->team->name, teams[turn].name) == 0)
-							{
-								return 1;
-							}
-							else 
-							{
-								Unit* proddedUnit = currentUnit->position->unit;
-								
-								for (int i = 0; i < 4; i++)
-								{
-									Tile* currentSpawn = proddedUnit->team->spawn[i];
-
-									if (currentSpawn->unit == NULL)
-									{
-										proddedUnit->position = currentSpawn;
-										currentSpawn->unit = proddedUnit;
-
-										// break loop
-										i = 4;
-									}
-								}
-								
-								moveLegal = 1;
-							}
-						}
-
-						if (moveLegal)
-						{
-							currentUnit->position->unit = currentUnit;
-							origPos->unit = NULL;
-							turn = (turn + 1) % nrOfTeams;
-							setGamePhase(ROLL);
-						}
-						else
-						{
-							currentUnit->position = origPos;
-						}
-					}
+					moveSelectedUnit();
 				}
 				else if (e->key.keysym.sym == SDLK_s)
 				{
-					turn = (turn + 1) % nrOfTeams;
-					setGamePhase(ROLL);
+					skipTurn();
 				}
 				else if (e->key.keysym.sym == SDLK_RIGHT) 
 				{
-					selectedUnitIndex = (selectedUnitIndex + 1) % teamSize;
+					selectedUnitIndex = (selectedUnitIndex + 1) % rules->teamSize;
 				}
 				else if (e->key.keysym.sym == SDLK_LEFT) 
 				{
 					selectedUnitIndex--;
 					if (selectedUnitIndex < 0) {
-						selectedUnitIndex = teamSize - 1;
+						selectedUnitIndex = rules->teamSize - 1;
 					}
 				}
 			}
@@ -703,19 +567,334 @@ void setGamePhase(GamePhase p)
 		case ROLL:
 			phase = ROLL;
 			selectedUnitIndex = 0;
-			char msg1[6 + 38 + 30] = "Team ";
-			strcat_s(msg1, 74, teams[turn].name);
-			char msg2[38] = "'s turn. Press Space to roll the die.";
-			strcat_s(msg1, 59, msg2);
-			loadFromRenderedText(gameMsgTexture, renderer, font, msg1, (SDL_Color){ 0, 0, 0 });
+			SDL_snprintf(gameMsg, GAME_MSG_SIZE, "Team %s's turn. Press Space to roll the die.", board.teams[turn].name);
+			loadFromRenderedText(gameMsgTexture, renderer, font, gameMsg, (SDL_Color){ 0, 0, 0 });
 			break;
 		case MOVE:
 			phase = MOVE;
-			char msg3[6 + 23 + 30] = "Team ";
-			strcat_s(msg3, 59, teams[turn].name);
-			char msg4[23] = "'s turn. Move a piece.";
-			strcat_s(msg3, 59, msg4);
-			loadFromRenderedText(gameMsgTexture, renderer, font, msg3, (SDL_Color){ 0, 0, 0 });
+			SDL_snprintf(gameMsg, GAME_MSG_SIZE, "Team %s's turn. Move a piece.", board.teams[turn].name);
+			loadFromRenderedText(gameMsgTexture, renderer, font, gameMsg, (SDL_Color){ 0, 0, 0 });
 			break;
 	}
-}
\ No newline at end of file
+}
+
+void syncUnits()
+{
+	syncBoardView(&board, &position);
+}
+
+void startRoll()
+{
+	castDie(die);
+	//dieAnimation->die = die;
+
+	// TODO: why is this not 1 sec???
+	dieAnimation->remainingFrames = 60;
+	pauseInput = 1;
+	setGamePhase(MOVE);
+}
+
+void moveSelectedUnit()
+{
+	// Illegal moves are ignored, the player has to pick another unit or skip
+	if (applyMove(rules, &position, turn * rules->teamSize + selectedUnitIndex, die->currentValue, NULL))
+	{
+		syncUnits();
+		turn = position.turn;
+		setGamePhase(ROLL);
+	}
+}
+
+void skipTurn()
+{
+	passTurn(rules, &position);
+	turn = position.turn;
+	setGamePhase(ROLL);
+}
+
+void playAiTurn()
+{
+	if (phase == ROLL)
+	{
+		startRoll();
+	}
+	else if (phase == MOVE)
+	{
+		int unit = chooseMove(&aiWeights, rules, &position, die->currentValue);
+		if (unit < 0)
+		{
+			skipTurn();
+		}
+		else
+		{
+			selectedUnitIndex = unit % rules->teamSize;
+			moveSelectedUnit();
+		}
+	}
+}
+
+/***** PAUSE MENU *****/
+Texture* pauseMsgTexture;
+int loadPauseMenu(Arena* arena)
+{
+	int success = 1;
+
+	pauseMsgTexture = arenaTexture(arena);
+	if (pauseMsgTexture == NULL || !loadFromRenderedText(pauseMsgTexture, renderer, font, "Paused. Escape to resume, Q to quit.", (SDL_Color){ 0, 0, 0 }))
+	{
+		printf("Failed to render pause text!\n");
+		success = 0;
+	}
+
+	return success;
+}
+
+void renderPauseMenu()
+{
+	// Fade out the game underneath
+	SDL_Rect screen = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(renderer, BACKGROUND_WHITE.r, BACKGROUND_WHITE.g, BACKGROUND_WHITE.b, 0xC0);
+	SDL_RenderFillRect(renderer, &screen);
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+	renderTexture(pauseMsgTexture, renderer, (SCREEN_WIDTH - pauseMsgTexture->width) / 2, (SCREEN_HEIGHT - pauseMsgTexture->height) / 2, NULL, 0, NULL, SDL_FLIP_NONE);
+}
+
+int handlePauseMenuEvent(SDL_Event* e)
+{
+	int success = 1;
+
+	if (e->type == SDL_KEYDOWN)
+	{
+		// back to the match, exactly as it was left
+		if (e->key.keysym.sym == SDLK_ESCAPE)
+		{
+			popScene();
+		}
+		// quit to main menu
+		else if (e->key.keysym.sym == SDLK_q)
+		{
+			if (!setScene(&mainMenuScene))
+			{
+				printf("Failed to load main menu!\n");
+				success = 0;
+			}
+		}
+	}
+
+	return success;
+}
+
+/***** SPECTATOR *****/
+Spectator spectator;
+int shownRolls;
+int loadSpectator(Arena* arena)
+{
+	// Spectating reuses the game scene, driven by the feed instead of the keyboard
+	if (!loadGame(arena) || !connectSpectator(&spectator, rules, spectatedHost, spectatedPort, spectatedMatch))
+	{
+		return 0;
+	}
+
+	if (recordPath != NULL && !recordSpectator(&spectator, recordPath))
+	{
+		closeSpectator(&spectator);
+		return 0;
+	}
+
+	shownRolls = 0;
+	setSpectatorMessage();
+
+	return 1;
+}
+
+void unloadSpectator()
+{
+	closeSpectator(&spectator);
+}
+
+void updateSpectator()
+{
+	FeedState* state = &spectator.state;
+	int updates = spectator.socket == INVALID_SOCKET ? 0 : pollSpectator(&spectator);
+
+	if (updates < 0)
+	{
+		closeSpectator(&spectator);
+		if (spectator.rejected)
+		{
+			SDL_snprintf(gameMsg, GAME_MSG_SIZE, "The server refused to show match %u.", spectatedMatch);
+		}
+		else
+		{
+			SDL_snprintf(gameMsg, GAME_MSG_SIZE, "Lost connection to the server.");
+		}
+		loadFromRenderedText(gameMsgTexture, renderer, font, gameMsg, (SDL_Color){ 0, 0, 0 });
+	}
+	else if (updates > 0 && state->synced)
+	{
+		position = state->position;
+		syncUnits();
+
+		if (position.turn != turn)
+		{
+			phase = ROLL;
+		}
+
+		// Show the die of the team that is about to move
+		if (state->rollCount != shownRolls)
+		{
+			shownRolls = state->rollCount;
+			if (state->dieTeam == position.turn)
+			{
+				die->currentValue = state->dieValue;
+				die->clip.x = die->clip.w * (die->currentValue - 1);
+				dieAnimation->remainingFrames = 60;
+				phase = MOVE;
+			}
+		}
+
+		turn = position.turn;
+		setSpectatorMessage();
+	}
+
+	updateGame();
+}
+
+int handleSpectatorEvent(SDL_Event* e)
+{
+	int success = 1;
+
+	if (e->type == SDL_KEYDOWN && e->key.keysym.sym == SDLK_ESCAPE)
+	{
+		if (!setScene(&mainMenuScene))
+		{
+			printf("Failed to load main menu!\n");
+			success = 0;
+		}
+	}
+
+	return success;
+}
+
+void setSpectatorMessage()
+{
+	FeedState* state = &spectator.state;
+
+	if (!state->synced)
+	{
+		SDL_snprintf(gameMsg, GAME_MSG_SIZE, "Waiting for match %u...", spectatedMatch);
+	}
+	else if (state->winner >= rules->teams)
+	{
+		SDL_snprintf(gameMsg, GAME_MSG_SIZE, "The match was abandoned.");
+	}
+	else if (state->winner >= 0)
+	{
+		SDL_snprintf(gameMsg, GAME_MSG_SIZE, "Team %s won!", board.teams[state->winner].name);
+	}
+	else
+	{
+		SDL_snprintf(gameMsg, GAME_MSG_SIZE, "Watching: Team %s's turn.", board.teams[turn].name);
+	}
+
+	loadFromRenderedText(gameMsgTexture, renderer, font, gameMsg, (SDL_Color){ 0, 0, 0 });
+}
+
+/***** WALL *****/
+Wall wall;
+Layout wallLayout;
+BoardView wallView;
+Weights wallWeights;
+Uint32 wallStatsTicks;
+int wallStatsTurns;
+int loadWall(Arena* arena)
+{
+	/* Scene objects, all owned by the scene arena */
+	Texture* wallSprite = arenaTexture(arena);
+	Texture* boardTexture = arenaTexture(arena);
+	Texture* atlas = arenaTexture(arena);
+	Texture* wallTexture = arenaTexture(arena);
+	if (wallSprite == NULL || boardTexture == NULL || atlas == NULL || wallTexture == NULL)
+	{
+		return 0;
+	}
+
+	if (!loadPlayersSprite(wallSprite, renderer, "players.png"))
+	{
+		printf("Failed to load texture image!\n");
+		return 0;
+	}
+
+	// Every board on the wall is the same variant, laid out once and scaled down
+	if (!prepareLayout(&wallLayout, &boardDescription))
+	{
+		return 0;
+	}
+
+	if (!loadWeights(&wallWeights, "weights.bin"))
+	{
+		defaultWeights(&wallWeights);
+	}
+
+	startWall(&wall, &wallLayout, &wallWeights, wallBoards, wallTurnMs, (Uint32)time(NULL));
+	if (!prepareWall(&wall, renderer, &wallView, wallSprite, boardTexture, atlas, wallTexture))
+	{
+		stopWall(&wall);
+		return 0;
+	}
+
+	wallStatsTicks = SDL_GetTicks();
+	wallStatsTurns = 0;
+
+	return 1;
+}
+
+void unloadWall()
+{
+	stopWall(&wall);
+	SDL_SetWindowTitle(window, "Fia");
+}
+
+void updateWall()
+{
+	// The wall has no room for text, how it is doing goes into the title once a second
+	Uint32 now = SDL_GetTicks();
+	if (now - wallStatsTicks >= 1000)
+	{
+		int turns = SDL_AtomicGet(&wall.turnsPlayed);
+		char title[GAME_MSG_SIZE];
+		SDL_snprintf(title, sizeof(title), "Fia - %d games, %d finished, %.0f turns/s", wall.boardCount,
+			SDL_AtomicGet(&wall.finishedGames), (turns - wallStatsTurns) * 1000.0 / (now - wallStatsTicks));
+		SDL_SetWindowTitle(window, title);
+
+		wallStatsTicks = now;
+		wallStatsTurns = turns;
+	}
+}
+
+void renderWall()
+{
+	drawWall(&wall, renderer);
+}
+
+int handleWallEvent(SDL_Event* e)
+{
+	int success = 1;
+
+	if (e->type == SDL_RENDER_TARGETS_RESET)
+	{
+		drawWallTextures(&wall, renderer);
+	}
+	else if (e->type == SDL_KEYDOWN && e->key.keysym.sym == SDLK_ESCAPE)
+	{
+		if (!setScene(&mainMenuScene))
+		{
+			printf("Failed to load main menu!\n");
+			success = 0;
+		}
+	}
+
+	return success;
+}
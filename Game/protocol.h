@@ -0,0 +1,60 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <SDL_stdinc.h>
+
+#define SERVER_PORT 27027
+#define MESSAGE_SIZE 8
+
+typedef struct Message Message;
+
+/*
+ * Client to server: JOIN (match), ROLL, MOVE (unit), SKIP, WATCH (match).
+ * Server to client: JOINED (seat), START (value is the starting seat),
+ * ROLLED (seat, value), MOVED (seat, unit, value), PASSED (seat),
+ * WON (seat), REJECTED and ABANDONED when a player leaves mid match.
+ * WATCH is answered with WATCH when accepted or REJECTED, after an accepted
+ * WATCH the server only sends the spectator feed (see feed.h).
+ */
+typedef enum
+{
+	MSG_JOIN, MSG_ROLL, MSG_MOVE, MSG_SKIP,
+	MSG_JOINED, MSG_START, MSG_ROLLED, MSG_MOVED, MSG_PASSED, MSG_WON, MSG_REJECTED, MSG_ABANDONED,
+	MSG_WATCH
+} MessageType;
+
+struct Message
+{
+	Uint8 type;
+	Uint8 seat;
+	Uint8 unit;
+	Uint8 value;
+	Uint32 match;
+};
+
+void encodeMessage(const Message* message, Uint8* data);
+void decodeMessage(const Uint8* data, Message* message);
+
+void encodeMessage(const Message* message, Uint8* data)
+{
+	// Fixed size and byte order, independent of the struct layout
+	data[0] = message->type;
+	data[1] = message->seat;
+	data[2] = message->unit;
+	data[3] = message->value;
+	data[4] = (Uint8)(message->match >> 24);
+	data[5] = (Uint8)(message->match >> 16);
+	data[6] = (Uint8)(message->match >> 8);
+	data[7] = (Uint8)message->match;
+}
+
+void decodeMessage(const Uint8* data, Message* message)
+{
+	message->type = data[0];
+	message->seat = data[1];
+	message->unit = data[2];
+	message->value = data[3];
+	message->match = ((Uint32)data[4] << 24) | ((Uint32)data[5] << 16) | ((Uint32)data[6] << 8) | data[7];
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL_stdinc.h>
+#include <rules.h>
+#include <feed.h>
+
+#define REPLAY_MAGIC 0x52414946 // "FIAR"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 6
+
+typedef struct Replay Replay;
+
+/*
+ * A recorded match: the board variant followed by the spectator feed of
+ * the match exactly as it was sent, so anything that can record a feed can
+ * record a replay. The header is six Uint32: magic, version, teams, team
+ * size, ring size and finish size.
+ */
+struct Replay
+{
+	Rules rules;
+	Uint8* updates;
+	int size;
+};
+
+// Replay functions
+int beginReplay(FILE* file, const Rules* rules);
+int writeReplayUpdate(FILE* file, const Uint8* data, int size);
+int loadReplay(Replay* replay, const char* path);
+void freeReplay(Replay* replay);
+
+int beginReplay(FILE* file, const Rules* rules)
+{
+	Uint32 header[REPLAY_HEADER_SIZE] = { REPLAY_MAGIC, REPLAY_VERSION, (Uint32)rules->teams, (Uint32)rules->teamSize, (Uint32)rules->ringSize, (Uint32)rules->finishSize };
+	return fwrite(header, sizeof(Uint32), REPLAY_HEADER_SIZE, file) == REPLAY_HEADER_SIZE;
+}
+
+int writeReplayUpdate(FILE* file, const Uint8* data, int size)
+{
+	return fwrite(data, 1, size, file) == (size_t)size;
+}
+
+int loadReplay(Replay* replay, const char* path)
+{
+	replay->updates = NULL;
+	replay->size = 0;
+
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		printf("Unable to open replay %s!\n", path);
+		return 0;
+	}
+
+	Uint32 header[REPLAY_HEADER_SIZE];
+	if (fread(header, sizeof(Uint32), REPLAY_HEADER_SIZE, file) != REPLAY_HEADER_SIZE ||
+		header[0] != REPLAY_MAGIC || header[1] != REPLAY_VERSION)
+	{
+		printf("Replay %s has an unknown format!\n", path);
+		fclose(file);
+		return 0;
+	}
+
+	if (!setupRules(&replay->rules, (int)header[2], (int)header[3], (int)header[4], (int)header[5]))
+	{
+		fclose(file);
+		return 0;
+	}
+
+	// The feed is tiny, a long match is a few kilobytes
+	fseek(file, 0, SEEK_END);
+	long end = ftell(file);
+	fseek(file, REPLAY_HEADER_SIZE * sizeof(Uint32), SEEK_SET);
+	replay->size = (int)(end - REPLAY_HEADER_SIZE * sizeof(Uint32));
+	replay->updates = (Uint8*)malloc(replay->size > 0 ? replay->size : 1);
+
+	int success = replay->updates != NULL && fread(replay->updates, 1, replay->size, file) == (size_t)replay->size;
+	if (!success)
+	{
+		printf("Unable to read replay %s!\n", path);
+		freeReplay(replay);
+	}
+
+	fclose(file);
+	return success;
+}
+
+void freeReplay(Replay* replay)
+{
+	free(replay->updates);
+	replay->updates = NULL;
+	replay->size = 0;
+}
+
+#endif
@@ -0,0 +1,418 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL_stdinc.h>
+#include <rules.h>
+
+#if !defined(FIA_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FIA_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define RESULTS_MAGIC 0x53414946 // "FIAS"
+#define RESULTS_VERSION 1
+#define RESULTS_HEADER_SIZE 8
+#define RESULTS_BLOCK_ROWS 16384
+#define RESULTS_ALIGNMENT 16
+#define NO_WINNER 0xFF
+
+// Fixed columns, followed by prods and turns in spawn for every team
+#define COLUMN_SEED 0
+#define COLUMN_FIRST_TEAM 1
+#define COLUMN_WINNER 2
+#define COLUMN_TURNS 3
+#define COLUMN_PRODS 4
+#define RESULTS_MAX_COLUMNS (COLUMN_PRODS + 2 * MAX_TEAMS)
+
+typedef struct GameResult GameResult;
+typedef struct ColumnStats ColumnStats;
+typedef struct ResultsBlock ResultsBlock;
+typedef struct ResultsBlockView ResultsBlockView;
+
+/*
+ * One simulated game. The seed replays it with "Simulator record", first
+ * team is the team that opened, so the seat of a team is its distance
+ * from it in turn order.
+ */
+struct GameResult
+{
+	Uint32 seed;
+	Uint8 firstTeam;
+	Uint8 winner;
+	Uint16 turns;
+	Uint16 prods[MAX_TEAMS];
+	Uint16 spawnTurns[MAX_TEAMS];
+};
+
+/*
+ * Results file: a header of eight Uint32 (magic, version, teams, team
+ * size, ring size, finish size, column count, rows per block) followed by
+ * blocks of up to RESULTS_BLOCK_ROWS games.
+ *
+ * A block starts with its row count and its size in bytes, then a
+ * ColumnStats per column and the column data. Every column is stored as
+ * the distance from its minimum in 0, 8, 16 or 32 bits per row, whichever
+ * fits the block's range, so the statistics double as the frame of
+ * reference. Columns and blocks are aligned to RESULTS_ALIGNMENT bytes.
+ * Blocks are appended as they fill up, a file cut off by a crash holds
+ * every block written before it.
+ */
+struct ColumnStats
+{
+	Uint32 min;
+	Uint32 max;
+	Uint32 offset;
+	Uint32 bits;
+};
+
+struct ResultsBlock
+{
+	int rows;
+	Uint32 values[RESULTS_MAX_COLUMNS][RESULTS_BLOCK_ROWS];
+};
+
+struct ResultsBlockView
+{
+	int rows;
+	int columnCount;
+	const ColumnStats* stats;
+	const Uint8* data;
+};
+
+// Results functions
+int resultsColumnCount(const Rules* rules);
+int prodsColumn(const Rules* rules, int team);
+int spawnColumn(const Rules* rules, int team);
+int beginResults(FILE* file, const Rules* rules);
+int addGameResult(ResultsBlock* block, const Rules* rules, const GameResult* result);
+int writeResultsBlock(FILE* file, const Rules* rules, ResultsBlock* block);
+int readResultsHeader(const Uint8* data, Uint64 size, Rules* rules);
+Uint64 readResultsBlock(const Uint8* data, Uint64 size, int columnCount, ResultsBlockView* view);
+void decodeColumn(const ResultsBlockView* view, int column, Uint32* values);
+void selectRange(const Uint32* values, int rows, Uint32 low, Uint32 high, Uint8* selection);
+Uint64 sumSelected(const Uint32* values, const Uint8* selection, int rows);
+void rangeSelected(const Uint32* values, const Uint8* selection, int rows, Uint32* min, Uint32* max);
+
+int resultsColumnCount(const Rules* rules)
+{
+	return COLUMN_PRODS + 2 * rules->teams;
+}
+
+int prodsColumn(const Rules* rules, int team)
+{
+	return COLUMN_PRODS + team;
+}
+
+int spawnColumn(const Rules* rules, int team)
+{
+	return COLUMN_PRODS + rules->teams + team;
+}
+
+int beginResults(FILE* file, const Rules* rules)
+{
+	Uint32 header[RESULTS_HEADER_SIZE] = { RESULTS_MAGIC, RESULTS_VERSION, (Uint32)rules->teams, (Uint32)rules->teamSize,
+		(Uint32)rules->ringSize, (Uint32)rules->finishSize, (Uint32)resultsColumnCount(rules), RESULTS_BLOCK_ROWS };
+	return fwrite(header, sizeof(Uint32), RESULTS_HEADER_SIZE, file) == RESULTS_HEADER_SIZE;
+}
+
+/*
+ * Adds a game to the block, returns 1 when the block is full and has to
+ * be written.
+ */
+int addGameResult(ResultsBlock* block, const Rules* rules, const GameResult* result)
+{
+	int row = block->rows++;
+	block->values[COLUMN_SEED][row] = result->seed;
+	block->values[COLUMN_FIRST_TEAM][row] = result->firstTeam;
+	block->values[COLUMN_WINNER][row] = result->winner;
+	block->values[COLUMN_TURNS][row] = result->turns;
+
+	for (int team = 0; team < rules->teams; team++)
+	{
+		block->values[prodsColumn(rules, team)][row] = result->prods[team];
+		block->values[spawnColumn(rules, team)][row] = result->spawnTurns[team];
+	}
+
+	return block->rows == RESULTS_BLOCK_ROWS;
+}
+
+static Uint32 alignResults(Uint32 size)
+{
+	return (size + RESULTS_ALIGNMENT - 1) & ~(Uint32)(RESULTS_ALIGNMENT - 1);
+}
+
+int writeResultsBlock(FILE* file, const Rules* rules, ResultsBlock* block)
+{
+	static const Uint8 padding[RESULTS_ALIGNMENT] = { 0 };
+	int columnCount = resultsColumnCount(rules);
+	int rows = block->rows;
+	if (rows == 0)
+	{
+		return 1;
+	}
+
+	/* Statistics, which decide the width of every column */
+	ColumnStats stats[RESULTS_MAX_COLUMNS];
+	Uint32 offset = alignResults(2 * sizeof(Uint32) + columnCount * sizeof(ColumnStats));
+	for (int column = 0; column < columnCount; column++)
+	{
+		const Uint32* values = block->values[column];
+		Uint32 min = values[0], max = values[0];
+		for (int i = 1; i < rows; i++)
+		{
+			min = values[i] < min ? values[i] : min;
+			max = values[i] > max ? values[i] : max;
+		}
+
+		Uint32 range = max - min;
+		Uint32 bits = range == 0 ? 0 : range <= 0xFF ? 8 : range <= 0xFFFF ? 16 : 32;
+		stats[column] = (ColumnStats){ .min = min, .max = max, .offset = offset, .bits = bits };
+		offset = alignResults(offset + rows * bits / 8);
+	}
+
+	Uint32 blockHeader[2] = { (Uint32)rows, offset };
+	int success = fwrite(blockHeader, sizeof(Uint32), 2, file) == 2 &&
+		fwrite(stats, sizeof(ColumnStats), columnCount, file) == (size_t)columnCount;
+	Uint32 written = 2 * sizeof(Uint32) + columnCount * sizeof(ColumnStats);
+
+	/* Column data, narrowed in place since the block is written only once */
+	for (int column = 0; column < columnCount && success; column++)
+	{
+		Uint32* values = block->values[column];
+		Uint32 min = stats[column].min;
+		int size = rows * stats[column].bits / 8;
+
+		success = fwrite(padding, 1, stats[column].offset - written, file) == stats[column].offset - written;
+		if (stats[column].bits == 8)
+		{
+			Uint8* narrow = (Uint8*)values;
+			for (int i = 0; i < rows; i++)
+			{
+				narrow[i] = (Uint8)(values[i] - min);
+			}
+		}
+		else if (stats[column].bits == 16)
+		{
+			Uint16* narrow = (Uint16*)values;
+			for (int i = 0; i < rows; i++)
+			{
+				narrow[i] = (Uint16)(values[i] - min);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < rows && stats[column].bits == 32; i++)
+			{
+				values[i] -= min;
+			}
+		}
+
+		success = success && fwrite(values, 1, size, file) == (size_t)size;
+		written = stats[column].offset + size;
+	}
+
+	success = success && fwrite(padding, 1, offset - written, file) == offset - written;
+	block->rows = 0;
+	return success;
+}
+
+int readResultsHeader(const Uint8* data, Uint64 size, Rules* rules)
+{
+	const Uint32* header = (const Uint32*)data;
+	if (size < RESULTS_HEADER_SIZE * sizeof(Uint32) || header[0] != RESULTS_MAGIC || header[1] != RESULTS_VERSION)
+	{
+		printf("Not a results file of this version!\n");
+		return 0;
+	}
+
+	if (!setupRules(rules, (int)header[2], (int)header[3], (int)header[4], (int)header[5]))
+	{
+		return 0;
+	}
+
+	if (header[6] != (Uint32)resultsColumnCount(rules) || header[7] != RESULTS_BLOCK_ROWS)
+	{
+		printf("Results file has an unexpected layout!\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Reads the block at data, of which size bytes are available. Returns the
+ * size of the block, or 0 if it is cut off or damaged.
+ */
+Uint64 readResultsBlock(const Uint8* data, Uint64 size, int columnCount, ResultsBlockView* view)
+{
+	const Uint32* blockHeader = (const Uint32*)data;
+	Uint64 statsEnd = 2 * sizeof(Uint32) + columnCount * sizeof(ColumnStats);
+	if (size < statsEnd || blockHeader[0] == 0 || blockHeader[0] > RESULTS_BLOCK_ROWS || blockHeader[1] > size)
+	{
+		return 0;
+	}
+
+	view->rows = (int)blockHeader[0];
+	view->columnCount = columnCount;
+	view->stats = (const ColumnStats*)&blockHeader[2];
+	view->data = data;
+
+	for (int column = 0; column < columnCount; column++)
+	{
+		const ColumnStats* stats = &view->stats[column];
+		if ((stats->bits != 0 && stats->bits != 8 && stats->bits != 16 && stats->bits != 32) ||
+			stats->offset % RESULTS_ALIGNMENT != 0 || stats->offset + (Uint64)view->rows * stats->bits / 8 > blockHeader[1])
+		{
+			return 0;
+		}
+	}
+
+	return blockHeader[1];
+}
+
+/*
+ * Widens a column to full Uint32 values. Whole vectors are decoded, so
+ * values must have room for the row count rounded up to 16; the padding
+ * behind every column keeps the reads inside the block.
+ */
+void decodeColumn(const ResultsBlockView* view, int column, Uint32* values)
+{
+	const ColumnStats* stats = &view->stats[column];
+	const Uint8* data = view->data + stats->offset;
+	int rows = view->rows;
+
+#ifdef FIA_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i min = _mm_set1_epi32((int)stats->min);
+
+	if (stats->bits == 8)
+	{
+		for (int i = 0; i < rows; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*)&data[i]);
+			__m128i low = _mm_unpacklo_epi8(bytes, zero);
+			__m128i high = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_si128((__m128i*)&values[i], _mm_add_epi32(_mm_unpacklo_epi16(low, zero), min));
+			_mm_storeu_si128((__m128i*)&values[i + 4], _mm_add_epi32(_mm_unpackhi_epi16(low, zero), min));
+			_mm_storeu_si128((__m128i*)&values[i + 8], _mm_add_epi32(_mm_unpacklo_epi16(high, zero), min));
+			_mm_storeu_si128((__m128i*)&values[i + 12], _mm_add_epi32(_mm_unpackhi_epi16(high, zero), min));
+		}
+	}
+	else if (stats->bits == 16)
+	{
+		for (int i = 0; i < rows; i += 8)
+		{
+			__m128i words = _mm_loadu_si128((const __m128i*)&data[2 * i]);
+			_mm_storeu_si128((__m128i*)&values[i], _mm_add_epi32(_mm_unpacklo_epi16(words, zero), min));
+			_mm_storeu_si128((__m128i*)&values[i + 4], _mm_add_epi32(_mm_unpackhi_epi16(words, zero), min));
+		}
+	}
+	else if (stats->bits == 32)
+	{
+		for (int i = 0; i < rows; i += 4)
+		{
+			__m128i words = _mm_loadu_si128((const __m128i*)&data[4 * i]);
+			_mm_storeu_si128((__m128i*)&values[i], _mm_add_epi32(words, min));
+		}
+	}
+	else
+	{
+		for (int i = 0; i < rows; i += 4)
+		{
+			_mm_storeu_si128((__m128i*)&values[i], min);
+		}
+	}
+#else
+	for (int i = 0; i < rows; i++)
+	{
+		Uint32 value = stats->bits == 8 ? data[i] : stats->bits == 16 ? ((const Uint16*)data)[i] : stats->bits == 32 ? ((const Uint32*)data)[i] : 0;
+		values[i] = stats->min + value;
+	}
+#endif
+}
+
+/*
+ * Clears the selection of every row whose value is outside [low, high].
+ * Selected rows are 0xFF, so the selection also works as a mask.
+ */
+void selectRange(const Uint32* values, int rows, Uint32 low, Uint32 high, Uint8* selection)
+{
+#ifdef FIA_SSE2
+	// SSE2 only compares signed, flipping the top bit keeps the unsigned order
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	const __m128i lowBound = _mm_xor_si128(_mm_set1_epi32((int)low), bias);
+	const __m128i highBound = _mm_xor_si128(_mm_set1_epi32((int)high), bias);
+
+	for (int i = 0; i < rows; i += 16)
+	{
+		__m128i outside[4];
+		for (int j = 0; j < 4; j++)
+		{
+			__m128i value = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&values[i + 4 * j]), bias);
+			outside[j] = _mm_or_si128(_mm_cmplt_epi32(value, lowBound), _mm_cmpgt_epi32(value, highBound));
+		}
+
+		// All ones and zeros stay that way through the saturating packs
+		__m128i mask = _mm_packs_epi16(_mm_packs_epi32(outside[0], outside[1]), _mm_packs_epi32(outside[2], outside[3]));
+		__m128i selected = _mm_loadu_si128((const __m128i*)&selection[i]);
+		_mm_storeu_si128((__m128i*)&selection[i], _mm_andnot_si128(mask, selected));
+	}
+#else
+	for (int i = 0; i < rows; i++)
+	{
+		selection[i] &= values[i] >= low && values[i] <= high ? 0xFF : 0;
+	}
+#endif
+}
+
+Uint64 sumSelected(const Uint32* values, const Uint8* selection, int rows)
+{
+	Uint64 sum = 0;
+
+#ifdef FIA_SSE2
+	// Sums are kept in 64 bit lanes, a block of seeds would overflow 32
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sums = zero;
+	int i = 0;
+	for (; i + 4 <= rows; i += 4)
+	{
+		int bytes;
+		SDL_memcpy(&bytes, &selection[i], sizeof(bytes));
+		__m128i mask = _mm_cvtsi32_si128(bytes);
+		mask = _mm_unpacklo_epi16(_mm_unpacklo_epi8(mask, mask), _mm_unpacklo_epi8(mask, mask));
+		__m128i value = _mm_and_si128(_mm_loadu_si128((const __m128i*)&values[i]), mask);
+		sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(value, zero));
+		sums = _mm_add_epi64(sums, _mm_unpackhi_epi32(value, zero));
+	}
+
+	Uint64 lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, sums);
+	sum = lanes[0] + lanes[1];
+#else
+	int i = 0;
+#endif
+
+	for (; i < rows; i++)
+	{
+		sum += selection[i] ? values[i] : 0;
+	}
+
+	return sum;
+}
+
+// Widens min and max to the selected values. SSE2 has no unsigned 32 bit min, and this only runs on partly selected blocks
+void rangeSelected(const Uint32* values, const Uint8* selection, int rows, Uint32* min, Uint32* max)
+{
+	for (int i = 0; i < rows; i++)
+	{
+		if (selection[i])
+		{
+			*min = SDL_min(*min, values[i]);
+			*max = SDL_max(*max, values[i]);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdio.h>
+#include <SDL_stdinc.h>
+
+// Limits of the board variants, sized so a Position stays a flat byte array
+#define MAX_TEAMS 8
+#define MAX_TEAM_SIZE 8
+#define MAX_UNITS (MAX_TEAMS * MAX_TEAM_SIZE)
+#define MAX_PROGRESS 127
+#define MAX_DIE 6
+
+// The standard board
+#define STANDARD_TEAMS 4
+#define STANDARD_TEAM_SIZE 4
+#define STANDARD_RING_SIZE 24
+#define STANDARD_FINISH_SIZE 2
+
+// A unit's progress counts the steps it has taken along its own route:
+// 0 is the spawn, 1..ringSize the outer ring starting at the team's start tile,
+// then the finish stretch and finally the center of the board (rules->goal).
+#define PROGRESS_SPAWN 0
+#define NOT_ON_RING 0xFF
+
+typedef struct Rules Rules;
+typedef struct Position Position;
+typedef struct MoveResult MoveResult;
+
+/*
+ * The board variant being played plus lookup tables derived from it, so
+ * the hot paths never have to walk the route or take a modulo.
+ */
+struct Rules
+{
+	int teams;
+	int teamSize;
+	int units;
+	int ringSize;
+	int finishSize;
+	int goal;
+
+	// Ring tile a team's unit stands on for each progress, NOT_ON_RING off the ring
+	Uint8 ringTile[MAX_TEAMS][MAX_PROGRESS + 1];
+	// Progress after moving a number of steps, bouncing back from the goal
+	Uint8 advance[MAX_PROGRESS + 1][MAX_DIE + 1];
+	Uint8 teamOf[MAX_UNITS];
+};
+
+/*
+ * Compact, pointer free game state. Holds the same information as the
+ * tiles/teams arrays of the UI, but small enough to copy around freely
+ * for simulation, evaluation and networking. Only the first rules->units
+ * entries of progress are used.
+ */
+struct Position
+{
+	Uint8 progress[MAX_UNITS];
+	Uint8 turn;
+};
+
+struct MoveResult
+{
+	int unit;
+	int from;
+	int to;
+	int proddedUnit;
+};
+
+int setupRules(Rules* rules, int teams, int teamSize, int ringSize, int finishSize);
+void resetPosition(Position* pos);
+int teamStartTile(const Rules* rules, int team);
+int ringTileOf(const Rules* rules, int team, int progress);
+int moveTarget(const Rules* rules, const Position* pos, int unit, int dieValue);
+int applyMove(const Rules* rules, Position* pos, int unit, int dieValue, MoveResult* result);
+void passTurn(const Rules* rules, Position* pos);
+int generateMoves(const Rules* rules, const Position* pos, int dieValue, int* units);
+int winningTeam(const Rules* rules, const Position* pos);
+Uint32 nextRandom(Uint32* state);
+int rollDie(Uint32* state, int sides);
+
+int setupRules(Rules* rules, int teams, int teamSize, int ringSize, int finishSize)
+{
+	if (teams < 2 || teams > MAX_TEAMS || teamSize < 1 || teamSize > MAX_TEAM_SIZE ||
+		ringSize < teams || finishSize < 1 || ringSize + finishSize + 1 > MAX_PROGRESS)
+	{
+		printf("Unsupported board: %d teams of %d, ring %d, finish %d!\n", teams, teamSize, ringSize, finishSize);
+		return 0;
+	}
+
+	SDL_memset(rules, 0, sizeof(Rules));
+	rules->teams = teams;
+	rules->teamSize = teamSize;
+	rules->units = teams * teamSize;
+	rules->ringSize = ringSize;
+	rules->finishSize = finishSize;
+	rules->goal = ringSize + finishSize + 1;
+
+	for (int team = 0; team < teams; team++)
+	{
+		SDL_memset(rules->ringTile[team], NOT_ON_RING, sizeof(rules->ringTile[team]));
+		for (int progress = 1; progress <= ringSize; progress++)
+		{
+			rules->ringTile[team][progress] = (Uint8)((teamStartTile(rules, team) + progress - 1) % ringSize);
+		}
+	}
+
+	for (int progress = 0; progress <= rules->goal; progress++)
+	{
+		int target = progress;
+		for (int steps = 0; steps <= MAX_DIE; steps++)
+		{
+			rules->advance[progress][steps] = (Uint8)target;
+
+			// Overshooting the center bounces the unit back onto the finish stretch
+			target = target == rules->goal ? rules->goal - 1 : target + 1;
+		}
+	}
+
+	for (int i = 0; i < rules->units; i++)
+	{
+		rules->teamOf[i] = (Uint8)(i / teamSize);
+	}
+
+	return 1;
+}
+
+void resetPosition(Position* pos)
+{
+	SDL_memset(pos, 0, sizeof(Position));
+}
+
+int teamStartTile(const Rules* rules, int team)
+{
+	return team * rules->ringSize / rules->teams;
+}
+
+int ringTileOf(const Rules* rules, int team, int progress)
+{
+	// Units in the spawn, on the finish stretch or in the goal are not on the ring
+	int tile = rules->ringTile[team][progress];
+	return tile == NOT_ON_RING ? -1 : tile;
+}
+
+int moveTarget(const Rules* rules, const Position* pos, int unit, int dieValue)
+{
+	int team = rules->teamOf[unit];
+	int progress = pos->progress[unit];
+
+	// Finished units stay put and the spawn can only be left on a 1 or a 6
+	if (progress == rules->goal || (progress == PROGRESS_SPAWN && dieValue != 1 && dieValue != 6))
+	{
+		return -1;
+	}
+
+	progress = rules->advance[progress][dieValue];
+
+	// The goal holds any number of units, every other tile only one per team
+	if (progress != rules->goal)
+	{
+		for (int i = team * rules->teamSize; i < (team + 1) * rules->teamSize; i++)
+		{
+			if (i != unit && pos->progress[i] == progress)
+			{
+				return -1;
+			}
+		}
+	}
+
+	return progress;
+}
+
+int applyMove(const Rules* rules, Position* pos, int unit, int dieValue, MoveResult* result)
+{
+	int target = moveTarget(rules, pos, unit, dieValue);
+	if (target < 0)
+	{
+		return 0;
+	}
+
+	int team = rules->teamOf[unit];
+	MoveResult move = { .unit = unit, .from = pos->progress[unit], .to = target, .proddedUnit = -1 };
+
+	// Landing on another team's unit prods it back to its spawn
+	int targetTile = rules->ringTile[team][target];
+	if (targetTile != NOT_ON_RING)
+	{
+		for (int i = 0; i < rules->units; i++)
+		{
+			if (rules->teamOf[i] != team && rules->ringTile[rules->teamOf[i]][pos->progress[i]] == targetTile)
+			{
+				pos->progress[i] = PROGRESS_SPAWN;
+				move.proddedUnit = i;
+				break;
+			}
+		}
+	}
+
+	pos->progress[unit] = (Uint8)target;
+	passTurn(rules, pos);
+
+	if (result != NULL)
+	{
+		*result = move;
+	}
+
+	return 1;
+}
+
+void passTurn(const Rules* rules, Position* pos)
+{
+	pos->turn = (pos->turn + 1) % rules->teams;
+}
+
+int generateMoves(const Rules* rules, const Position* pos, int dieValue, int* units)
+{
+	int count = 0;
+	for (int i = pos->turn * rules->teamSize; i < (pos->turn + 1) * rules->teamSize; i++)
+	{
+		if (moveTarget(rules, pos, i, dieValue) >= 0)
+		{
+			units[count++] = i;
+		}
+	}
+
+	return count;
+}
+
+int winningTeam(const Rules* rules, const Position* pos)
+{
+	for (int team = 0; team < rules->teams; team++)
+	{
+		int finished = 0;
+		for (int i = team * rules->teamSize; i < (team + 1) * rules->teamSize; i++)
+		{
+			finished += pos->progress[i] == rules->goal;
+		}
+
+		if (finished == rules->teamSize)
+		{
+			return team;
+		}
+	}
+
+	return -1;
+}
+
+Uint32 nextRandom(Uint32* state)
+{
+	// xorshift32, so every simulation thread can own its random stream
+	Uint32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+int rollDie(Uint32* state, int sides)
+{
+	return (int)(nextRandom(state) % (Uint32)sides) + 1;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <arena.h>
+
+#define SCENE_ARENA_SIZE (64 * 1024)
+#define MAX_SCENES 8
+
+typedef struct Scene Scene;
+
+/*
+ * A scene owns an arena holding everything it loads. Scenes sit on a stack:
+ * only the top one gets events and updates, the ones below are suspended
+ * with their state and resources untouched. An overlay scene also lets the
+ * scene below it render, so a menu can be drawn on top of a running game.
+ */
+struct Scene
+{
+	int(*load)(Arena* arena);
+	void(*update)();
+	void(*render)();
+	int(*handleEvent)(SDL_Event* e);
+	void(*unload)();
+	int overlay;
+	int loaded;
+	Arena arena;
+};
+
+Scene* sceneStack[MAX_SCENES];
+int sceneCount = 0;
+
+// Scene functions
+int loadScene(Scene* scene);
+void unloadScene(Scene* scene);
+void closeScene(Scene* scene);
+int pushScene(Scene* scene);
+void popScene();
+int setScene(Scene* scene);
+void updateScenes();
+void renderScenes();
+int handleSceneEvent(SDL_Event* e);
+
+int loadScene(Scene* scene)
+{
+	// Loading a scene that is already resident costs nothing, this is what makes preloading work
+	if (scene->loaded)
+	{
+		return 1;
+	}
+
+	if (scene->arena.memory == NULL && !createArena(&scene->arena, SCENE_ARENA_SIZE))
+	{
+		return 0;
+	}
+
+	scene->loaded = scene->load(&scene->arena);
+	if (!scene->loaded)
+	{
+		resetArena(&scene->arena);
+	}
+
+	return scene->loaded;
+}
+
+void unloadScene(Scene* scene)
+{
+	if (scene->loaded)
+	{
+		if (scene->unload != NULL)
+		{
+			scene->unload();
+		}
+		resetArena(&scene->arena);
+		scene->loaded = 0;
+	}
+}
+
+void closeScene(Scene* scene)
+{
+	unloadScene(scene);
+	destroyArena(&scene->arena);
+}
+
+int pushScene(Scene* scene)
+{
+	if (sceneCount == MAX_SCENES)
+	{
+		printf("Scene stack is full!\n");
+		return 0;
+	}
+
+	if (!loadScene(scene))
+	{
+		return 0;
+	}
+
+	sceneStack[sceneCount++] = scene;
+	return 1;
+}
+
+void popScene()
+{
+	// The popped scene stays loaded, showing it again is instant
+	if (sceneCount > 0)
+	{
+		sceneCount--;
+	}
+}
+
+int setScene(Scene* scene)
+{
+	//Tear down everything on the stack except the scene we are switching to
+	for (int i = sceneCount - 1; i >= 0; i--)
+	{
+		if (sceneStack[i] != scene)
+		{
+			unloadScene(sceneStack[i]);
+		}
+	}
+
+	sceneCount = 0;
+	return pushScene(scene);
+}
+
+void updateScenes()
+{
+	if (sceneCount > 0 && sceneStack[sceneCount - 1]->update != NULL)
+	{
+		sceneStack[sceneCount - 1]->update();
+	}
+}
+
+void renderScenes()
+{
+	//Find the lowest scene that is still visible and draw upwards from there
+	int bottom = sceneCount - 1;
+	while (bottom > 0 && sceneStack[bottom]->overlay)
+	{
+		bottom--;
+	}
+
+	for (int i = bottom < 0 ? 0 : bottom; i < sceneCount; i++)
+	{
+		sceneStack[i]->render();
+	}
+}
+
+int handleSceneEvent(SDL_Event* e)
+{
+	if (sceneCount == 0)
+	{
+		return 0;
+	}
+
+	return sceneStack[sceneCount - 1]->handleEvent(e);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <rules.h>
+#include <evaluator.h>
+
+// Hard stop for games that would otherwise go on for ever
+#define MAX_TURNS 5000
+
+int playTurn(const Rules* rules, Position* pos, const Weights* weights, Uint32* rng, float epsilon, MoveResult* result);
+
+/*
+ * Plays one turn for the team whose turn it is: casts the die and moves
+ * the unit picked by the evaluator, or a random legal unit with
+ * probability epsilon. Passes the turn when no unit can move.
+ * Returns 1 if a unit was moved and fills in result.
+ */
+int playTurn(const Rules* rules, Position* pos, const Weights* weights, Uint32* rng, float epsilon, MoveResult* result)
+{
+	int dieValue = rollDie(rng, 6);
+	int unit;
+
+	if (epsilon > 0 && (nextRandom(rng) & 0xFFFF) < (Uint32)(epsilon * 0x10000))
+	{
+		int units[MAX_TEAM_SIZE];
+		int moveCount = generateMoves(rules, pos, dieValue, units);
+		unit = moveCount > 0 ? units[nextRandom(rng) % moveCount] : -1;
+	}
+	else
+	{
+		unit = chooseMove(weights, rules, pos, dieValue);
+	}
+
+	if (unit < 0)
+	{
+		passTurn(rules, pos);
+		return 0;
+	}
+
+	return applyMove(rules, pos, unit, dieValue, result);
+}
+
+#endif
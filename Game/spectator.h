@@ -0,0 +1,188 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <stdio.h>
+#include <protocol.h>
+#include <feed.h>
+#include <replay.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+typedef struct Spectator
+{
+	SOCKET socket;
+	Uint32 match;
+	int accepted;
+	int rejected;
+	Uint8 data[1024];
+	int received;
+	FeedState state;
+	FILE* recording;
+} Spectator;
+
+// Spectator functions
+int connectSpectator(Spectator* spectator, const Rules* rules, const char* host, int port, Uint32 match);
+int recordSpectator(Spectator* spectator, const char* path);
+int pollSpectator(Spectator* spectator);
+void closeSpectator(Spectator* spectator);
+
+int connectSpectator(Spectator* spectator, const Rules* rules, const char* host, int port, Uint32 match)
+{
+	spectator->socket = INVALID_SOCKET;
+	spectator->match = match;
+	spectator->accepted = 0;
+	spectator->rejected = 0;
+	spectator->received = 0;
+	spectator->recording = NULL;
+	resetFeedState(&spectator->state, rules);
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		printf("Winsock could not initialize!\n");
+		return 0;
+	}
+
+	//Resolve the server address
+	char service[16];
+	struct addrinfo hints = { 0 };
+	struct addrinfo* address = NULL;
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	SDL_snprintf(service, sizeof(service), "%d", port);
+	if (getaddrinfo(host, service, &hints, &address) != 0)
+	{
+		printf("Unable to resolve %s:%d!\n", host, port);
+		WSACleanup();
+		return 0;
+	}
+
+	spectator->socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+	if (spectator->socket == INVALID_SOCKET ||
+		connect(spectator->socket, address->ai_addr, (int)address->ai_addrlen) == SOCKET_ERROR)
+	{
+		printf("Unable to connect to %s:%d! Winsock Error: %d\n", host, port, WSAGetLastError());
+		freeaddrinfo(address);
+		if (spectator->socket == INVALID_SOCKET)
+		{
+			WSACleanup();
+		}
+		closeSpectator(spectator);
+		return 0;
+	}
+	freeaddrinfo(address);
+
+	//Subscribe to the match feed
+	Uint8 data[MESSAGE_SIZE];
+	Message message = { .type = MSG_WATCH, .seat = 0, .unit = 0, .value = 0, .match = match };
+	encodeMessage(&message, data);
+	send(spectator->socket, (const char*)data, MESSAGE_SIZE, 0);
+
+	//Never block the render loop on the network
+	u_long nonBlocking = 1;
+	ioctlsocket(spectator->socket, FIONBIO, &nonBlocking);
+
+	return 1;
+}
+
+int recordSpectator(Spectator* spectator, const char* path)
+{
+	spectator->recording = fopen(path, "wb");
+	if (spectator->recording == NULL || !beginReplay(spectator->recording, spectator->state.rules))
+	{
+		printf("Unable to record the match to %s!\n", path);
+		return 0;
+	}
+
+	return 1;
+}
+
+int pollSpectator(Spectator* spectator)
+{
+	int updates = 0;
+
+	//Drain the socket, applying every complete update
+	for (;;)
+	{
+		int bytes = recv(spectator->socket, (char*)&spectator->data[spectator->received], sizeof(spectator->data) - spectator->received, 0);
+		if (bytes == 0 || (bytes == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK))
+		{
+			return -1;
+		}
+		else if (bytes == SOCKET_ERROR)
+		{
+			return updates;
+		}
+
+		spectator->received += bytes;
+		int offset = 0;
+		for (;;)
+		{
+			//The server answers WATCH with a single message, the feed only follows an accepted one
+			if (!spectator->accepted)
+			{
+				if (spectator->received - offset < MESSAGE_SIZE)
+				{
+					break;
+				}
+
+				Message reply;
+				decodeMessage(&spectator->data[offset], &reply);
+				offset += MESSAGE_SIZE;
+				if (reply.type != MSG_WATCH)
+				{
+					printf("The server refused to show match %u!\n", spectator->match);
+					spectator->rejected = 1;
+					return -1;
+				}
+
+				spectator->accepted = 1;
+				continue;
+			}
+
+			int used = applyFeedUpdate(&spectator->state, &spectator->data[offset], spectator->received - offset);
+			if (used < 0)
+			{
+				printf("Corrupt spectator feed!\n");
+				return -1;
+			}
+			else if (used == 0)
+			{
+				break;
+			}
+
+			if (spectator->recording != NULL)
+			{
+				writeReplayUpdate(spectator->recording, &spectator->data[offset], used);
+			}
+
+			offset += used;
+			updates++;
+		}
+
+		spectator->received -= offset;
+		memmove(spectator->data, &spectator->data[offset], spectator->received);
+	}
+}
+
+void closeSpectator(Spectator* spectator)
+{
+	if (spectator->recording != NULL)
+	{
+		fclose(spectator->recording);
+		spectator->recording = NULL;
+	}
+
+
+	if (spectator->socket != INVALID_SOCKET)
+	{
+		closesocket(spectator->socket);
+		spectator->socket = INVALID_SOCKET;
+		WSACleanup();
+	}
+}
+
+#endif
@@ -0,0 +1,408 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <texture.h>
+#include <rules.h>
+#include <evaluator.h>
+#include <simulation.h>
+#include <board.h>
+#include <boardview.h>
+
+#define MAX_WALL_BOARDS 64
+#define DEFAULT_WALL_BOARDS 16
+#define MAX_WALL_THREADS 8
+// A turn every 200ms keeps the games readable, 0 plays them as fast as the threads go
+#define DEFAULT_WALL_TURN_MS 200
+// How long a finished game stays up with its winner before the next one starts
+#define WALL_END_MS 2000
+// Simulation threads wake at least this often to notice the wall closing
+#define WALL_MAX_SLEEP_MS 50
+// Boards are at least this far apart
+#define WALL_GAP 2
+
+typedef struct WallGame WallGame;
+typedef struct WallWorker WallWorker;
+typedef struct Wall Wall;
+
+/*
+ * One game on the wall. The simulation thread owning it plays on its own
+ * position and publishes a copy under the spin lock after every turn; the
+ * render thread takes the copy only when the version moved on. Each thread
+ * owns a contiguous run of games, so neighbouring games written by
+ * different threads only meet at the ends of those runs.
+ */
+struct WallGame
+{
+	SDL_SpinLock lock;
+	Position position;
+	int winner;
+	Uint32 version;
+
+	// Only touched by the simulation thread
+	Position playing;
+	Uint32 rng;
+	int turns;
+	Uint32 nextTurn;
+};
+
+struct WallWorker
+{
+	Wall* wall;
+	int first;
+	int last;
+};
+
+/*
+ * Many AI games at once, each drawn as a scaled board in a grid. The empty
+ * board is drawn once into a texture and every unit comes from one atlas
+ * holding all team sprites already tinted, so a cell is a board copy plus
+ * a copy per unit with no state changes in between. Cells are kept in a
+ * screen sized texture and only redrawn when their game moved.
+ */
+struct Wall
+{
+	const Layout* layout;
+	const Weights* weights;
+	int boardCount;
+	int turnMs;
+	WallGame games[MAX_WALL_BOARDS];
+
+	SDL_Thread* threads[MAX_WALL_THREADS];
+	WallWorker workers[MAX_WALL_THREADS];
+	int threadCount;
+	SDL_atomic_t running;
+	SDL_atomic_t finishedGames;
+	SDL_atomic_t turnsPlayed;
+
+	/* Rendering, owned by the render thread */
+	BoardView* view;
+	Texture* playersSprite;
+	Texture* boardTexture;
+	Texture* atlas;
+	Texture* wallTexture;
+	SDL_Rect atlasClips[MAX_TEAMS];
+	Uint32 shownVersions[MAX_WALL_BOARDS];
+	int columns;
+	int left;
+	int top;
+	int cellWidth;
+	int cellHeight;
+	float scale;
+	int redrawAll;
+};
+
+// Wall functions
+void startWall(Wall* wall, const Layout* layout, const Weights* weights, int boardCount, int turnMs, Uint32 seed);
+void stopWall(Wall* wall);
+int wallThread(void* data);
+void restartWallGame(Wall* wall, WallGame* game, Uint32 now);
+int prepareWall(Wall* wall, SDL_Renderer* renderer, BoardView* view, Texture* playersSprite, Texture* boardTexture, Texture* atlas, Texture* wallTexture);
+void drawWallTextures(Wall* wall, SDL_Renderer* renderer);
+void drawWall(Wall* wall, SDL_Renderer* renderer);
+void drawWallCell(Wall* wall, SDL_Renderer* renderer, int index, const Position* pos, int winner);
+
+void startWall(Wall* wall, const Layout* layout, const Weights* weights, int boardCount, int turnMs, Uint32 seed)
+{
+	wall->layout = layout;
+	wall->weights = weights;
+	wall->boardCount = boardCount < 1 ? 1 : boardCount > MAX_WALL_BOARDS ? MAX_WALL_BOARDS : boardCount;
+	wall->turnMs = turnMs < 0 ? 0 : turnMs;
+	SDL_AtomicSet(&wall->finishedGames, 0);
+	SDL_AtomicSet(&wall->turnsPlayed, 0);
+
+	Uint32 now = SDL_GetTicks();
+	for (int i = 0; i < wall->boardCount; i++)
+	{
+		WallGame* game = &wall->games[i];
+		game->lock = 0;
+		game->version = 0;
+		wall->shownVersions[i] = 0;
+
+		// xorshift must never be seeded with zero
+		game->rng = (seed += 0x9E3779B9) | 1;
+		restartWallGame(wall, game, now);
+
+		// Spread the first turns out, so the games do not all move on the same frame
+		game->nextTurn = now + (wall->turnMs > 0 ? nextRandom(&game->rng) % wall->turnMs : 0);
+	}
+
+	// The render thread keeps a core, the rest play the games
+	int cores = SDL_GetCPUCount() - 1;
+	wall->threadCount = SDL_min(SDL_max(cores, 1), SDL_min(wall->boardCount, MAX_WALL_THREADS));
+	SDL_AtomicSet(&wall->running, 1);
+	for (int i = 0; i < wall->threadCount; i++)
+	{
+		wall->workers[i] = (WallWorker){ .wall = wall, .first = i * wall->boardCount / wall->threadCount, .last = (i + 1) * wall->boardCount / wall->threadCount };
+		wall->threads[i] = SDL_CreateThread(wallThread, "wall", &wall->workers[i]);
+	}
+}
+
+void stopWall(Wall* wall)
+{
+	SDL_AtomicSet(&wall->running, 0);
+	for (int i = 0; i < wall->threadCount; i++)
+	{
+		SDL_WaitThread(wall->threads[i], NULL);
+	}
+	wall->threadCount = 0;
+}
+
+int wallThread(void* data)
+{
+	WallWorker* worker = (WallWorker*)data;
+	Wall* wall = worker->wall;
+	const Rules* rules = &wall->layout->rules;
+
+	while (SDL_AtomicGet(&wall->running))
+	{
+		Uint32 now = SDL_GetTicks();
+		Uint32 sleep = WALL_MAX_SLEEP_MS;
+		int played = 0;
+
+		for (int i = worker->first; i < worker->last; i++)
+		{
+			WallGame* game = &wall->games[i];
+			if ((Sint32)(now - game->nextTurn) < 0)
+			{
+				sleep = SDL_min(sleep, game->nextTurn - now);
+				continue;
+			}
+
+			if (game->winner >= 0 || game->turns >= MAX_TURNS)
+			{
+				restartWallGame(wall, game, now);
+				continue;
+			}
+
+			playTurn(rules, &game->playing, wall->weights, &game->rng, 0.0f, NULL);
+			game->turns++;
+			played = 1;
+			SDL_AtomicAdd(&wall->turnsPlayed, 1);
+
+			int winner = winningTeam(rules, &game->playing);
+			if (winner >= 0)
+			{
+				SDL_AtomicAdd(&wall->finishedGames, 1);
+			}
+			game->nextTurn = now + (winner >= 0 ? WALL_END_MS : wall->turnMs);
+
+			SDL_AtomicLock(&game->lock);
+			game->position = game->playing;
+			game->winner = winner;
+			game->version++;
+			SDL_AtomicUnlock(&game->lock);
+		}
+
+		// Flat out the threads only rest while every game of theirs shows its winner
+		if (wall->turnMs > 0 || !played)
+		{
+			SDL_Delay(sleep);
+		}
+	}
+
+	return 0;
+}
+
+void restartWallGame(Wall* wall, WallGame* game, Uint32 now)
+{
+	resetPosition(&game->playing);
+	game->playing.turn = (Uint8)(nextRandom(&game->rng) % wall->layout->rules.teams);
+	game->turns = 0;
+	game->nextTurn = now + wall->turnMs;
+
+	SDL_AtomicLock(&game->lock);
+	game->position = game->playing;
+	game->winner = -1;
+	game->version++;
+	SDL_AtomicUnlock(&game->lock);
+}
+
+/*
+ * Creates the render target textures and lays out the grid for the
+ * renderer's output size. The textures are tracked by the caller.
+ */
+int prepareWall(Wall* wall, SDL_Renderer* renderer, BoardView* view, Texture* playersSprite, Texture* boardTexture, Texture* atlas, Texture* wallTexture)
+{
+	const BoardDescription* description = &wall->layout->description;
+	wall->view = view;
+	wall->playersSprite = playersSprite;
+	wall->boardTexture = boardTexture;
+	wall->atlas = atlas;
+	wall->wallTexture = wallTexture;
+
+	if (!SDL_RenderTargetSupported(renderer))
+	{
+		printf("The wall needs a renderer that can render to textures!\n");
+		return 0;
+	}
+
+	int width, height;
+	SDL_GetRendererOutputSize(renderer, &width, &height);
+
+	/* Grid, the column count that gives the largest boards */
+	wall->scale = 0;
+	for (int columns = 1; columns <= wall->boardCount; columns++)
+	{
+		int rows = (wall->boardCount + columns - 1) / columns;
+		float scale = SDL_min((float)(width / columns - WALL_GAP) / description->width, (float)(height / rows - WALL_GAP) / description->height);
+		if (scale > wall->scale)
+		{
+			wall->scale = scale;
+			wall->columns = columns;
+		}
+	}
+	wall->cellWidth = (int)(description->width * wall->scale);
+	wall->cellHeight = (int)(description->height * wall->scale);
+
+	int rows = (wall->boardCount + wall->columns - 1) / wall->columns;
+	wall->left = (width - wall->columns * (wall->cellWidth + WALL_GAP)) / 2;
+	wall->top = (height - rows * (wall->cellHeight + WALL_GAP)) / 2;
+
+	/* Textures */
+	Texture* targets[3] = { boardTexture, atlas, wallTexture };
+	int sizes[3][2] = { { description->width, description->height }, { MAX_TEAMS * playerWidth, playerHeight }, { width, height } };
+	for (int i = 0; i < 3; i++)
+	{
+		targets[i]->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, sizes[i][0], sizes[i][1]);
+		if (targets[i]->texture == NULL)
+		{
+			printf("Unable to create wall texture! SDL Error: %s\n", SDL_GetError());
+			return 0;
+		}
+		targets[i]->width = sizes[i][0];
+		targets[i]->height = sizes[i][1];
+	}
+	setTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+
+	setupBoardView(view, wall->layout, 0, 0);
+	for (int i = 0; i < MAX_TEAMS; i++)
+	{
+		wall->atlasClips[i] = (SDL_Rect){ .x = i * playerWidth, .y = 0, .w = playerWidth, .h = playerHeight };
+	}
+
+	drawWallTextures(wall, renderer);
+	return 1;
+}
+
+/*
+ * Draws the empty board and the sprite atlas and marks every cell for
+ * redrawing. Render targets lose their contents when the device is reset,
+ * so this runs again on SDL_RENDER_TARGETS_RESET.
+ */
+void drawWallTextures(Wall* wall, SDL_Renderer* renderer)
+{
+	const Rules* rules = &wall->layout->rules;
+
+	SDL_SetRenderTarget(renderer, wall->boardTexture->texture);
+	SDL_SetRenderDrawColor(renderer, BACKGROUND_WHITE.r, BACKGROUND_WHITE.g, BACKGROUND_WHITE.b, BACKGROUND_WHITE.a);
+	SDL_RenderClear(renderer);
+	renderBoardTiles(wall->view, renderer);
+
+	// Sprites are copied into the atlas as they are, alpha included
+	SDL_SetRenderTarget(renderer, wall->atlas->texture);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	SDL_RenderClear(renderer);
+	setTextureBlendMode(wall->playersSprite, SDL_BLENDMODE_NONE);
+	for (int i = 0; i < rules->teams; i++)
+	{
+		if (i >= 4)
+		{
+			setTextureColor(wall->playersSprite, TEAM_COLORS[i].r, TEAM_COLORS[i].g, TEAM_COLORS[i].b);
+		}
+		renderTexture(wall->playersSprite, renderer, wall->atlasClips[i].x, 0, &wall->view->teams[i].playerClip, 0, NULL, SDL_FLIP_NONE);
+	}
+	setTextureColor(wall->playersSprite, 0xFF, 0xFF, 0xFF);
+	setTextureBlendMode(wall->playersSprite, SDL_BLENDMODE_BLEND);
+
+	SDL_SetRenderTarget(renderer, wall->wallTexture->texture);
+	SDL_SetRenderDrawColor(renderer, BACKGROUND_WHITE.r, BACKGROUND_WHITE.g, BACKGROUND_WHITE.b, BACKGROUND_WHITE.a);
+	SDL_RenderClear(renderer);
+	SDL_SetRenderTarget(renderer, NULL);
+
+	wall->redrawAll = 1;
+}
+
+void drawWall(Wall* wall, SDL_Renderer* renderer)
+{
+	/* Redraw the cells whose game moved since the last frame */
+	int targetSet = 0;
+	for (int i = 0; i < wall->boardCount; i++)
+	{
+		WallGame* game = &wall->games[i];
+		Position pos;
+		int winner;
+		int changed;
+
+		SDL_AtomicLock(&game->lock);
+		changed = wall->redrawAll || game->version != wall->shownVersions[i];
+		if (changed)
+		{
+			pos = game->position;
+			winner = game->winner;
+			wall->shownVersions[i] = game->version;
+		}
+		SDL_AtomicUnlock(&game->lock);
+
+		if (changed)
+		{
+			if (!targetSet)
+			{
+				SDL_SetRenderTarget(renderer, wall->wallTexture->texture);
+				targetSet = 1;
+			}
+			drawWallCell(wall, renderer, i, &pos, winner);
+		}
+	}
+	wall->redrawAll = 0;
+
+	if (targetSet)
+	{
+		SDL_SetRenderTarget(renderer, NULL);
+	}
+
+	renderTexture(wall->wallTexture, renderer, 0, 0, NULL, 0, NULL, SDL_FLIP_NONE);
+}
+
+void drawWallCell(Wall* wall, SDL_Renderer* renderer, int index, const Position* pos, int winner)
+{
+	const Rules* rules = &wall->layout->rules;
+	float scale = wall->scale;
+	SDL_Rect cell = { wall->left + (index % wall->columns) * (wall->cellWidth + WALL_GAP) + WALL_GAP / 2,
+		wall->top + (index / wall->columns) * (wall->cellHeight + WALL_GAP) + WALL_GAP / 2, wall->cellWidth, wall->cellHeight };
+
+	// The board copy also wipes the units of the last frame
+	SDL_RenderCopy(renderer, wall->boardTexture->texture, NULL, &cell);
+
+	syncBoardView(wall->view, pos);
+	int spriteWidth = SDL_max((int)(playerWidth * scale), 2);
+	int spriteHeight = SDL_max((int)(playerHeight * scale), 3);
+	for (int i = 0; i < rules->teams; i++)
+	{
+		for (int j = 0; j < rules->teamSize; j++)
+		{
+			const Unit* unit = &wall->view->teams[i].units[j];
+			if (unit->finished || unit->position == NULL)
+			{
+				continue;
+			}
+
+			const Tile* tile = unit->position;
+			SDL_Rect sprite = { cell.x + (int)((tile->posX + tile->radius / 2) * scale) - spriteWidth / 2,
+				cell.y + (int)((tile->posY + tile->radius / 2) * scale) - spriteHeight / 2, spriteWidth, spriteHeight };
+			SDL_RenderCopy(renderer, wall->atlas->texture, &wall->atlasClips[i], &sprite);
+		}
+	}
+
+	// A finished game is framed in the winner's color until the next one starts
+	if (winner >= 0)
+	{
+		SDL_SetRenderDrawColor(renderer, TEAM_COLORS[winner].r, TEAM_COLORS[winner].g, TEAM_COLORS[winner].b, 0xFF);
+		SDL_RenderDrawRect(renderer, &cell);
+		SDL_Rect inner = { cell.x + 1, cell.y + 1, cell.w - 2, cell.h - 2 };
+		SDL_RenderDrawRect(renderer, &inner);
+	}
+}
+
+#endif
@@ -0,0 +1,570 @@
+#define WIN32_LEAN_AND_MEAN
+#define FD_SETSIZE 1024
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rules.h>
+#include <protocol.h>
+#include <evalprotocol.h>
+
+// Every client of a thread has to fit into one select set
+#define MATCHES_PER_THREAD (FD_SETSIZE / STANDARD_TEAMS)
+// Requests each evaluation client keeps in flight, the slot doubles as the request id
+#define EVAL_WINDOW 32
+#define EVAL_RECEIVE_SIZE (EVAL_WINDOW * EVAL_RESPONSE_MAX)
+
+typedef struct Client Client;
+typedef struct LoadThread LoadThread;
+typedef struct EvalThread EvalThread;
+
+/*
+ * One simulated player. Keeps its own copy of the position, updated from the
+ * server's broadcasts, to pick legal moves.
+ */
+struct Client
+{
+	SOCKET socket;
+	Uint32 match;
+	int seat;
+	Position position;
+	Uint8 data[64];
+	int received;
+	Uint64 sentAt;
+};
+
+struct LoadThread
+{
+	Client* clients;
+	int matchCount;
+	Uint32 firstMatch;
+	Uint32 rng;
+	int finished;
+	int rejected;
+	Uint32* latencies;
+	int latencyCount;
+	int latencyCapacity;
+};
+
+/*
+ * One client of the evaluation service. Walks through random games and
+ * asks about every position on the way, keeping EVAL_WINDOW requests
+ * pipelined on its connection.
+ */
+struct EvalThread
+{
+	SOCKET service;
+	Uint32 rng;
+	Position position;
+	Uint64 sentAt[EVAL_WINDOW];
+	Uint8 data[EVAL_RECEIVE_SIZE];
+	int received;
+	int busy;
+	int invalid;
+	Uint32* latencies;
+	int latencyCount;
+	int latencyCapacity;
+};
+
+/* Variables */
+Rules rules;
+struct sockaddr_in serverAddress;
+// Set before the threads start and never changed, a lost connection stops every thread through stopping instead
+Uint64 deadline;
+volatile LONG stopping = 0;
+double ticksPerMicrosecond;
+
+/* Funcion declarations */
+Uint64 now();
+int running();
+int connectClient(Client* client, Uint32 match);
+void sendToServer(Client* client, MessageType type, int unit);
+void handleServerMessage(LoadThread* thread, Client* client, const Message* message);
+DWORD WINAPI loadThread(LPVOID data);
+void addLatency(Uint32** latencies, int* count, int* capacity, Uint64 sentAt);
+void printLatencies(const char* name, Uint32* latencies, int count);
+int compareLatency(const void* a, const void* b);
+int evalLoad(int argc, char* args[]);
+int sendEvalRequest(EvalThread* thread, int slot);
+DWORD WINAPI evalThread(LPVOID data);
+
+/* Function definitions */
+int main(int argc, char* args[])
+{
+	if (argc > 1 && strcmp(args[1], "--eval") == 0)
+	{
+		return evalLoad(argc - 1, &args[1]);
+	}
+
+	const char* host = argc > 1 ? args[1] : "127.0.0.1";
+	int port = argc > 2 ? atoi(args[2]) : SERVER_PORT;
+	int matchCount = argc > 3 ? atoi(args[3]) : 1000;
+	int seconds = argc > 4 ? atoi(args[4]) : 10;
+
+	// The server only plays the standard board
+	setupRules(&rules, STANDARD_TEAMS, STANDARD_TEAM_SIZE, STANDARD_RING_SIZE, STANDARD_FINISH_SIZE);
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		printf("Winsock could not initialize!\n");
+		return 1;
+	}
+
+	memset(&serverAddress, 0, sizeof(serverAddress));
+	serverAddress.sin_family = AF_INET;
+	serverAddress.sin_port = htons((u_short)port);
+	if (inet_pton(AF_INET, host, &serverAddress.sin_addr) != 1)
+	{
+		printf("Invalid server address %s!\n", host);
+		return 1;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	ticksPerMicrosecond = frequency.QuadPart / 1000000.0;
+
+	int threadCount = (matchCount + MATCHES_PER_THREAD - 1) / MATCHES_PER_THREAD;
+	LoadThread* threads = (LoadThread*)calloc(threadCount, sizeof(LoadThread));
+	HANDLE* handles = (HANDLE*)malloc(threadCount * sizeof(HANDLE));
+
+	printf("Playing %d concurrent matches against %s:%d for %d seconds on %d threads.\n",
+		matchCount, host, port, seconds, threadCount);
+
+	Uint64 start = now();
+	deadline = start + (Uint64)(seconds * 1000000.0 * ticksPerMicrosecond);
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads[i].firstMatch = i * MATCHES_PER_THREAD;
+		threads[i].matchCount = i == threadCount - 1 ? matchCount - i * MATCHES_PER_THREAD : MATCHES_PER_THREAD;
+		threads[i].rng = (Uint32)(i * 0x9E3779B9) | 1;
+		handles[i] = CreateThread(NULL, 0, loadThread, &threads[i], 0, NULL);
+	}
+
+	WaitForMultipleObjects(threadCount, handles, TRUE, INFINITE);
+	double elapsed = (now() - start) / ticksPerMicrosecond / 1000000.0;
+
+	// Merge the results of all threads
+	int finished = 0, rejected = 0, latencyCount = 0;
+	for (int i = 0; i < threadCount; i++)
+	{
+		finished += threads[i].finished;
+		rejected += threads[i].rejected;
+		latencyCount += threads[i].latencyCount;
+		CloseHandle(handles[i]);
+	}
+
+	Uint32* latencies = (Uint32*)malloc((latencyCount + 1) * sizeof(Uint32));
+	int offset = 0;
+	for (int i = 0; i < threadCount; i++)
+	{
+		memcpy(&latencies[offset], threads[i].latencies, threads[i].latencyCount * sizeof(Uint32));
+		offset += threads[i].latencyCount;
+		free(threads[i].latencies);
+	}
+	qsort(latencies, latencyCount, sizeof(Uint32), compareLatency);
+
+	printf("%d matches finished in %.1fs: %.1f matches/s, %.0f moves/s, %d rejected messages\n",
+		finished, elapsed, finished / elapsed, latencyCount / elapsed, rejected);
+	printLatencies("Move", latencies, latencyCount);
+
+	free(latencies);
+	free(handles);
+	free(threads);
+	WSACleanup();
+	return 0;
+}
+
+Uint64 now()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+int running()
+{
+	return !stopping && now() < deadline;
+}
+
+int connectClient(Client* client, Uint32 match)
+{
+	memset(client, 0, sizeof(Client));
+	client->match = match;
+	client->seat = -1;
+
+	client->socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (client->socket == INVALID_SOCKET ||
+		connect(client->socket, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) == SOCKET_ERROR)
+	{
+		printf("Unable to connect! Winsock Error: %d\n", WSAGetLastError());
+		return 0;
+	}
+
+	BOOL noDelay = TRUE;
+	setsockopt(client->socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+	sendToServer(client, MSG_JOIN, 0);
+	return 1;
+}
+
+void sendToServer(Client* client, MessageType type, int unit)
+{
+	Message message = { .type = (Uint8)type, .seat = (Uint8)client->seat, .unit = (Uint8)unit, .value = 0, .match = client->match };
+	Uint8 data[MESSAGE_SIZE];
+	encodeMessage(&message, data);
+
+	client->sentAt = now();
+	send(client->socket, (const char*)data, MESSAGE_SIZE, 0);
+}
+
+void handleServerMessage(LoadThread* thread, Client* client, const Message* message)
+{
+	Position* pos = &client->position;
+	int myTurn = 0;
+
+	switch (message->type)
+	{
+		case MSG_JOINED:
+			client->seat = message->seat;
+			break;
+		case MSG_START:
+			resetPosition(pos);
+			pos->turn = message->value;
+			myTurn = 1;
+			break;
+		case MSG_ROLLED:
+			if (message->seat == client->seat)
+			{
+				// Play a random legal move, the server passes the turn if there is none
+				int units[MAX_TEAM_SIZE];
+				int moveCount = generateMoves(&rules, pos, message->value, units);
+				if (moveCount > 0)
+				{
+					int unit = units[nextRandom(&thread->rng) % moveCount];
+					sendToServer(client, MSG_MOVE, unit % rules.teamSize);
+				}
+			}
+			break;
+		case MSG_MOVED:
+			applyMove(&rules, pos, message->seat * rules.teamSize + message->unit, message->value, NULL);
+			if (message->seat == client->seat)
+			{
+				addLatency(&thread->latencies, &thread->latencyCount, &thread->latencyCapacity, client->sentAt);
+			}
+			myTurn = winningTeam(&rules, pos) < 0;
+			break;
+		case MSG_PASSED:
+			passTurn(&rules, pos);
+			myTurn = 1;
+			break;
+		case MSG_WON:
+		case MSG_ABANDONED:
+			// Count each match once and sit down at the same table again
+			if (message->type == MSG_WON && client->seat == 0)
+			{
+				thread->finished++;
+			}
+			client->seat = -1;
+			if (running())
+			{
+				sendToServer(client, MSG_JOIN, 0);
+			}
+			break;
+		case MSG_REJECTED:
+			thread->rejected++;
+			break;
+	}
+
+	if (myTurn && pos->turn == client->seat && running())
+	{
+		sendToServer(client, MSG_ROLL, 0);
+	}
+}
+
+DWORD WINAPI loadThread(LPVOID data)
+{
+	LoadThread* thread = (LoadThread*)data;
+	int clientCount = thread->matchCount * rules.teams;
+	thread->clients = (Client*)malloc(clientCount * sizeof(Client));
+
+	for (int i = 0; i < clientCount; i++)
+	{
+		if (!connectClient(&thread->clients[i], thread->firstMatch + i / rules.teams))
+		{
+			clientCount = i;
+			break;
+		}
+	}
+
+	while (running())
+	{
+		fd_set readable;
+		FD_ZERO(&readable);
+		for (int i = 0; i < clientCount; i++)
+		{
+			FD_SET(thread->clients[i].socket, &readable);
+		}
+
+		struct timeval timeout = { 0, 100000 };
+		if (select(0, &readable, NULL, NULL, &timeout) <= 0)
+		{
+			continue;
+		}
+
+		for (int i = 0; i < clientCount; i++)
+		{
+			Client* client = &thread->clients[i];
+			if (!FD_ISSET(client->socket, &readable))
+			{
+				continue;
+			}
+
+			int bytes = recv(client->socket, (char*)&client->data[client->received], sizeof(client->data) - client->received, 0);
+			if (bytes <= 0)
+			{
+				printf("Lost connection to the server!\n");
+				InterlockedExchange(&stopping, 1);
+				break;
+			}
+
+			client->received += bytes;
+			int offset = 0;
+			while (client->received - offset >= MESSAGE_SIZE)
+			{
+				Message message;
+				decodeMessage(&client->data[offset], &message);
+				handleServerMessage(thread, client, &message);
+				offset += MESSAGE_SIZE;
+			}
+
+			client->received -= offset;
+			memmove(client->data, &client->data[offset], client->received);
+		}
+	}
+
+	for (int i = 0; i < clientCount; i++)
+	{
+		closesocket(thread->clients[i].socket);
+	}
+	free(thread->clients);
+
+	return 0;
+}
+
+void addLatency(Uint32** latencies, int* count, int* capacity, Uint64 sentAt)
+{
+	if (*count == *capacity)
+	{
+		*capacity = *capacity == 0 ? 4096 : *capacity * 2;
+		*latencies = (Uint32*)realloc(*latencies, *capacity * sizeof(Uint32));
+	}
+	(*latencies)[(*count)++] = (Uint32)((now() - sentAt) / ticksPerMicrosecond);
+}
+
+void printLatencies(const char* name, Uint32* latencies, int count)
+{
+	if (count > 0)
+	{
+		printf("%s latency: p50 %uus, p90 %uus, p99 %uus, max %uus\n", name,
+			latencies[count / 2], latencies[count * 9 / 10],
+			latencies[count * 99 / 100], latencies[count - 1]);
+	}
+}
+
+int compareLatency(const void* a, const void* b)
+{
+	Uint32 x = *(const Uint32*)a;
+	Uint32 y = *(const Uint32*)b;
+	return x < y ? -1 : x > y;
+}
+
+int evalLoad(int argc, char* args[])
+{
+	const char* path = argc > 1 ? args[1] : EVAL_SOCKET_PATH;
+	int clientCount = argc > 2 ? atoi(args[2]) : 16;
+	int seconds = argc > 3 ? atoi(args[3]) : 10;
+	if (clientCount <= 0)
+	{
+		printf("Usage: loadgen --eval [socket path] [clients] [seconds]\n");
+		return 1;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	ticksPerMicrosecond = frequency.QuadPart / 1000000.0;
+
+	// Every client learns the board from the service's hello, it is the same for all of them
+	EvalThread* threads = (EvalThread*)calloc(clientCount, sizeof(EvalThread));
+	HANDLE* handles = (HANDLE*)malloc(clientCount * sizeof(HANDLE));
+	for (int i = 0; i < clientCount; i++)
+	{
+		threads[i].service = connectEvalService(path, &rules);
+		if (threads[i].service == INVALID_SOCKET)
+		{
+			clientCount = i;
+			break;
+		}
+		threads[i].rng = (Uint32)(i * 0x9E3779B9) | 1;
+
+		// Wakes the client up now and then to look at the deadline
+		DWORD timeout = 100;
+		setsockopt(threads[i].service, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+	}
+
+	if (clientCount == 0)
+	{
+		free(handles);
+		free(threads);
+		return 1;
+	}
+
+	printf("Asking %s for evaluations of %d teams of %d from %d clients with %d requests in flight each for %d seconds.\n",
+		path, rules.teams, rules.teamSize, clientCount, EVAL_WINDOW, seconds);
+
+	Uint64 start = now();
+	deadline = start + (Uint64)(seconds * 1000000.0 * ticksPerMicrosecond);
+
+	for (int i = 0; i < clientCount; i++)
+	{
+		handles[i] = CreateThread(NULL, 0, evalThread, &threads[i], 0, NULL);
+	}
+
+	WaitForMultipleObjects(clientCount, handles, TRUE, INFINITE);
+	double elapsed = (now() - start) / ticksPerMicrosecond / 1000000.0;
+
+	// Merge the results of all clients
+	int busy = 0, invalid = 0, latencyCount = 0;
+	for (int i = 0; i < clientCount; i++)
+	{
+		busy += threads[i].busy;
+		invalid += threads[i].invalid;
+		latencyCount += threads[i].latencyCount;
+		CloseHandle(handles[i]);
+		closesocket(threads[i].service);
+		WSACleanup();
+	}
+
+	Uint32* latencies = (Uint32*)malloc((latencyCount + 1) * sizeof(Uint32));
+	int offset = 0;
+	for (int i = 0; i < clientCount; i++)
+	{
+		memcpy(&latencies[offset], threads[i].latencies, threads[i].latencyCount * sizeof(Uint32));
+		offset += threads[i].latencyCount;
+		free(threads[i].latencies);
+	}
+	qsort(latencies, latencyCount, sizeof(Uint32), compareLatency);
+
+	printf("%d evaluations in %.1fs: %.0f evaluations/s, %d busy and %d invalid answers\n",
+		latencyCount, elapsed, latencyCount / elapsed, busy, invalid);
+	printLatencies("Evaluation", latencies, latencyCount);
+
+	free(latencies);
+	free(handles);
+	free(threads);
+	return 0;
+}
+
+int sendEvalRequest(EvalThread* thread, int slot)
+{
+	// Ask about the current position and move on with a random legal move
+	EvalRequest request = { .id = (Uint32)slot, .dieValue = (Uint8)(nextRandom(&thread->rng) % MAX_DIE + 1), .position = thread->position };
+	Uint8 data[EVAL_REQUEST_MAX];
+	encodeEvalRequest(&rules, &request, data);
+
+	int units[MAX_TEAM_SIZE];
+	int moveCount = generateMoves(&rules, &thread->position, request.dieValue, units);
+	if (moveCount > 0)
+	{
+		applyMove(&rules, &thread->position, units[nextRandom(&thread->rng) % moveCount], request.dieValue, NULL);
+	}
+	else
+	{
+		passTurn(&rules, &thread->position);
+	}
+	if (winningTeam(&rules, &thread->position) >= 0)
+	{
+		resetPosition(&thread->position);
+	}
+
+	thread->sentAt[slot] = now();
+	return send(thread->service, (const char*)data, evalRequestSize(&rules), 0) != SOCKET_ERROR;
+}
+
+DWORD WINAPI evalThread(LPVOID data)
+{
+	EvalThread* thread = (EvalThread*)data;
+	int responseSize = evalResponseSize(&rules);
+	resetPosition(&thread->position);
+
+	int inFlight = 0;
+	for (int slot = 0; slot < EVAL_WINDOW; slot++)
+	{
+		if (!sendEvalRequest(thread, slot))
+		{
+			printf("Lost connection to the evaluation service!\n");
+			return 1;
+		}
+		inFlight++;
+	}
+
+	// Every answer frees its slot for the next request until the time is up
+	while (inFlight > 0)
+	{
+		int bytes = recv(thread->service, (char*)&thread->data[thread->received], EVAL_RECEIVE_SIZE - thread->received, 0);
+		if (bytes <= 0)
+		{
+			if (bytes < 0 && WSAGetLastError() == WSAETIMEDOUT && running())
+			{
+				continue;
+			}
+			if (running())
+			{
+				printf("Lost connection to the evaluation service!\n");
+				InterlockedExchange(&stopping, 1);
+			}
+			break;
+		}
+
+		thread->received += bytes;
+		int offset = 0;
+		while (thread->received - offset >= responseSize)
+		{
+			EvalResponse response;
+			decodeEvalResponse(&rules, &thread->data[offset], &response);
+			offset += responseSize;
+			inFlight--;
+
+			int slot = (int)(response.id % EVAL_WINDOW);
+			if (response.status == EVAL_OK)
+			{
+				addLatency(&thread->latencies, &thread->latencyCount, &thread->latencyCapacity, thread->sentAt[slot]);
+			}
+			else if (response.status == EVAL_BUSY)
+			{
+				thread->busy++;
+			}
+			else
+			{
+				thread->invalid++;
+			}
+
+			if (running())
+			{
+				if (!sendEvalRequest(thread, slot))
+				{
+					break;
+				}
+				inFlight++;
+			}
+		}
+
+		thread->received -= offset;
+		memmove(thread->data, &thread->data[offset], thread->received);
+	}
+
+	return 0;
+}
@@ -0,0 +1,500 @@
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL_stdinc.h>
+#include <rules.h>
+#include <simulation.h>
+#include <results.h>
+
+// The file is mapped through a sliding view, a 32 bit process can not map billions of rows at once
+#define MAP_WINDOW (64 * 1024 * 1024)
+#define MAX_FILTERS 8
+#define DEFAULT_BUCKET 25
+#define HISTOGRAM_WIDTH 50
+
+typedef enum { QUERY_SUMMARY, QUERY_SEATS, QUERY_LENGTHS } QueryKind;
+
+typedef struct MappedFile
+{
+	HANDLE file;
+	HANDLE mapping;
+	Uint64 size;
+	const Uint8* view;
+	Uint64 viewOffset;
+	Uint64 viewSize;
+	Uint64 granularity;
+} MappedFile;
+
+typedef struct Filter
+{
+	int column;
+	Uint32 low;
+	Uint32 high;
+} Filter;
+
+typedef struct Query
+{
+	Rules rules;
+	int columnCount;
+	QueryKind kind;
+	int bucket;
+	Filter filters[MAX_FILTERS];
+	int filterCount;
+
+	// Scratch space for one block
+	Uint32* values;
+	Uint32* keys;
+	Uint8* selection;
+
+	// Results
+	int blocks;
+	int skippedBlocks;
+	Uint64 rows;
+	Uint64 selectedRows;
+	Uint64 unfinished;
+	Uint64 seatWins[MAX_TEAMS];
+	Uint64 teamWins[MAX_TEAMS];
+	Uint64 turnCounts[MAX_TURNS + 1];
+	Uint64 sums[RESULTS_MAX_COLUMNS];
+	Uint32 min[RESULTS_MAX_COLUMNS];
+	Uint32 max[RESULTS_MAX_COLUMNS];
+} Query;
+
+/* Funcion declarations */
+int openMappedFile(MappedFile* mapped, const char* path);
+const Uint8* mapRange(MappedFile* mapped, Uint64 offset, Uint64 size);
+void closeMappedFile(MappedFile* mapped);
+int findColumn(const Rules* rules, const char* name);
+void columnName(const Rules* rules, int column, char* name, int size);
+int runQuery(Query* query, MappedFile* mapped);
+void queryBlock(Query* query, const ResultsBlockView* view);
+void printQuery(const Query* query);
+
+/* Function definitions */
+int main(int argc, char* args[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s results.fias [summary | seats | lengths [bucket]] [--where column low high]...\n", args[0]);
+		printf("Columns are seed, first, winner, turns, prods1, spawn1 and so on, teams count from 1.\n");
+		return 1;
+	}
+
+	MappedFile mapped;
+	if (!openMappedFile(&mapped, args[1]))
+	{
+		return 1;
+	}
+
+	Query* query = (Query*)calloc(1, sizeof(Query));
+	const Uint8* header = mapRange(&mapped, 0, RESULTS_HEADER_SIZE * sizeof(Uint32));
+	if (query == NULL || header == NULL || !readResultsHeader(header, mapped.size, &query->rules))
+	{
+		free(query);
+		closeMappedFile(&mapped);
+		return 1;
+	}
+	query->columnCount = resultsColumnCount(&query->rules);
+	query->kind = QUERY_SUMMARY;
+	query->bucket = DEFAULT_BUCKET;
+
+	int arg = 2;
+	if (arg < argc && strcmp(args[arg], "seats") == 0)
+	{
+		query->kind = QUERY_SEATS;
+		arg++;
+	}
+	else if (arg < argc && strcmp(args[arg], "lengths") == 0)
+	{
+		query->kind = QUERY_LENGTHS;
+		arg++;
+		if (arg < argc && strncmp(args[arg], "--", 2) != 0)
+		{
+			query->bucket = SDL_max(1, atoi(args[arg]));
+			arg++;
+		}
+	}
+	else if (arg < argc && strcmp(args[arg], "summary") == 0)
+	{
+		arg++;
+	}
+
+	while (arg < argc)
+	{
+		int column = arg + 3 < argc && strcmp(args[arg], "--where") == 0 ? findColumn(&query->rules, args[arg + 1]) : -1;
+		if (column < 0 || query->filterCount == MAX_FILTERS)
+		{
+			printf("Invalid filter at %s!\n", args[arg]);
+			free(query);
+			closeMappedFile(&mapped);
+			return 1;
+		}
+
+		// Teams are shown counting from 1, and so are they filtered
+		Uint32 low = (Uint32)strtoul(args[arg + 2], NULL, 10);
+		Uint32 high = (Uint32)strtoul(args[arg + 3], NULL, 10);
+		if (column == COLUMN_FIRST_TEAM || column == COLUMN_WINNER)
+		{
+			low = low > 0 ? low - 1 : 0;
+			high = high > 0 ? high - 1 : 0;
+		}
+
+		query->filters[query->filterCount++] = (Filter){ .column = column, .low = low, .high = high };
+		arg += 4;
+	}
+
+	query->values = (Uint32*)malloc(RESULTS_BLOCK_ROWS * sizeof(Uint32));
+	query->keys = (Uint32*)malloc(RESULTS_BLOCK_ROWS * sizeof(Uint32));
+	query->selection = (Uint8*)malloc(RESULTS_BLOCK_ROWS);
+
+	int success = query->values != NULL && query->keys != NULL && query->selection != NULL && runQuery(query, &mapped);
+	if (success)
+	{
+		printQuery(query);
+	}
+
+	free(query->selection);
+	free(query->keys);
+	free(query->values);
+	free(query);
+	closeMappedFile(&mapped);
+
+	return success ? 0 : 1;
+}
+
+int openMappedFile(MappedFile* mapped, const char* path)
+{
+	memset(mapped, 0, sizeof(MappedFile));
+	mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mapped->file == INVALID_HANDLE_VALUE)
+	{
+		printf("Unable to open %s!\n", path);
+		return 0;
+	}
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(mapped->file, &size);
+	mapped->size = (Uint64)size.QuadPart;
+
+	// Mapping an empty file fails, the header check reports it instead
+	if (mapped->size > 0)
+	{
+		mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapped->mapping == NULL)
+		{
+			printf("Unable to map %s! Error: %lu\n", path, GetLastError());
+			CloseHandle(mapped->file);
+			return 0;
+		}
+	}
+
+	SYSTEM_INFO system;
+	GetSystemInfo(&system);
+	mapped->granularity = system.dwAllocationGranularity;
+
+	return 1;
+}
+
+/*
+ * Returns the bytes at offset, moving the view if they are not inside it.
+ * Pointers from earlier calls are invalid afterwards.
+ */
+const Uint8* mapRange(MappedFile* mapped, Uint64 offset, Uint64 size)
+{
+	if (offset + size > mapped->size)
+	{
+		return NULL;
+	}
+
+	if (mapped->view == NULL || offset < mapped->viewOffset || offset + size > mapped->viewOffset + mapped->viewSize)
+	{
+		if (mapped->view != NULL)
+		{
+			UnmapViewOfFile(mapped->view);
+		}
+
+		// Views have to start on the allocation granularity
+		Uint64 start = offset - offset % mapped->granularity;
+		Uint64 length = SDL_max(offset + size - start, (Uint64)MAP_WINDOW);
+		length = SDL_min(length, mapped->size - start);
+
+		mapped->view = (const Uint8*)MapViewOfFile(mapped->mapping, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)start, (SIZE_T)length);
+		if (mapped->view == NULL)
+		{
+			printf("Unable to map %llu bytes at %llu! Error: %lu\n", length, start, GetLastError());
+			return NULL;
+		}
+
+		mapped->viewOffset = start;
+		mapped->viewSize = length;
+	}
+
+	return mapped->view + (offset - mapped->viewOffset);
+}
+
+void closeMappedFile(MappedFile* mapped)
+{
+	if (mapped->view != NULL)
+	{
+		UnmapViewOfFile(mapped->view);
+	}
+	if (mapped->mapping != NULL)
+	{
+		CloseHandle(mapped->mapping);
+	}
+	CloseHandle(mapped->file);
+}
+
+int findColumn(const Rules* rules, const char* name)
+{
+	char candidate[16];
+	for (int column = 0; column < resultsColumnCount(rules); column++)
+	{
+		columnName(rules, column, candidate, sizeof(candidate));
+		if (strcmp(candidate, name) == 0)
+		{
+			return column;
+		}
+	}
+
+	return -1;
+}
+
+void columnName(const Rules* rules, int column, char* name, int size)
+{
+	static const char* fixedNames[COLUMN_PRODS] = { "seed", "first", "winner", "turns" };
+
+	if (column < COLUMN_PRODS)
+	{
+		SDL_snprintf(name, size, "%s", fixedNames[column]);
+	}
+	else if (column < spawnColumn(rules, 0))
+	{
+		SDL_snprintf(name, size, "prods%d", column - prodsColumn(rules, 0) + 1);
+	}
+	else
+	{
+		SDL_snprintf(name, size, "spawn%d", column - spawnColumn(rules, 0) + 1);
+	}
+}
+
+int runQuery(Query* query, MappedFile* mapped)
+{
+	for (int column = 0; column < query->columnCount; column++)
+	{
+		query->min[column] = 0xFFFFFFFF;
+	}
+
+	LARGE_INTEGER start, end, frequency;
+	QueryPerformanceCounter(&start);
+
+	Uint64 offset = RESULTS_HEADER_SIZE * sizeof(Uint32);
+	while (offset < mapped->size)
+	{
+		// The block header holds the size of the block, map that much once it is known
+		Uint64 remaining = mapped->size - offset;
+		const Uint8* data = mapRange(mapped, offset, SDL_min(remaining, (Uint64)(2 * sizeof(Uint32))));
+		Uint64 blockSize = data == NULL || remaining < 2 * sizeof(Uint32) ? 0 : ((const Uint32*)data)[1];
+		data = blockSize == 0 ? NULL : mapRange(mapped, offset, SDL_min(remaining, blockSize));
+
+		ResultsBlockView view;
+		Uint64 used = data == NULL ? 0 : readResultsBlock(data, SDL_min(remaining, blockSize), query->columnCount, &view);
+		if (used == 0)
+		{
+			printf("Results end in a damaged block at byte %llu, it is left out.\n", offset);
+			break;
+		}
+
+		queryBlock(query, &view);
+		offset += used;
+	}
+
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+	double seconds = (double)(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+
+	printf("Scanned %d of %d blocks, %llu of %llu rows selected, in %.1fms (%.0f million rows/s).\n",
+		query->blocks - query->skippedBlocks, query->blocks, query->selectedRows, query->rows,
+		seconds * 1000.0, seconds > 0 ? query->rows / seconds / 1e6 : 0.0);
+
+	return 1;
+}
+
+void queryBlock(Query* query, const ResultsBlockView* view)
+{
+	int rows = view->rows;
+	int teams = query->rules.teams;
+	query->blocks++;
+	query->rows += rows;
+
+	/* Blocks whose range misses a filter are skipped without touching their data */
+	int scanFilter[MAX_FILTERS];
+	for (int i = 0; i < query->filterCount; i++)
+	{
+		const Filter* filter = &query->filters[i];
+		const ColumnStats* stats = &view->stats[filter->column];
+		if (stats->max < filter->low || stats->min > filter->high)
+		{
+			query->skippedBlocks++;
+			return;
+		}
+
+		// A filter the whole block passes needs no scan either
+		scanFilter[i] = stats->min < filter->low || stats->max > filter->high;
+	}
+
+	/* Selection */
+	memset(query->selection, 0xFF, RESULTS_BLOCK_ROWS);
+	for (int i = 0; i < query->filterCount; i++)
+	{
+		if (scanFilter[i])
+		{
+			decodeColumn(view, query->filters[i].column, query->values);
+			selectRange(query->values, rows, query->filters[i].low, query->filters[i].high, query->selection);
+		}
+	}
+
+	Uint64 selected = 0;
+	for (int i = 0; i < rows; i++)
+	{
+		selected += query->selection[i] & 1;
+	}
+	query->selectedRows += selected;
+	if (selected == 0)
+	{
+		return;
+	}
+
+	/* Aggregates */
+	const Uint8* selection = query->selection;
+	if (query->kind == QUERY_SUMMARY)
+	{
+		// The block stats only hold for the selection when the filters kept every row
+		int wholeBlock = selected == (Uint64)rows;
+		for (int column = 0; column < query->columnCount; column++)
+		{
+			decodeColumn(view, column, query->values);
+			query->sums[column] += sumSelected(query->values, selection, rows);
+			if (wholeBlock)
+			{
+				query->min[column] = SDL_min(query->min[column], view->stats[column].min);
+				query->max[column] = SDL_max(query->max[column], view->stats[column].max);
+			}
+			else
+			{
+				rangeSelected(query->values, selection, rows, &query->min[column], &query->max[column]);
+			}
+		}
+	}
+	else if (query->kind == QUERY_SEATS)
+	{
+		Uint32* first = query->keys;
+		Uint32* winner = query->values;
+		decodeColumn(view, COLUMN_FIRST_TEAM, first);
+		decodeColumn(view, COLUMN_WINNER, winner);
+
+		for (int i = 0; i < rows; i++)
+		{
+			if (!selection[i])
+			{
+				continue;
+			}
+
+			if (winner[i] == NO_WINNER)
+			{
+				query->unfinished++;
+			}
+			else
+			{
+				query->seatWins[(winner[i] + teams - first[i]) % teams]++;
+				query->teamWins[winner[i]]++;
+			}
+		}
+	}
+	else
+	{
+		decodeColumn(view, COLUMN_TURNS, query->values);
+		for (int i = 0; i < rows; i++)
+		{
+			query->turnCounts[SDL_min(query->values[i], (Uint32)MAX_TURNS)] += selection[i] & 1;
+		}
+	}
+}
+
+void printQuery(const Query* query)
+{
+	Uint64 games = query->selectedRows;
+	if (games == 0)
+	{
+		printf("No games match.\n");
+		return;
+	}
+
+	if (query->kind == QUERY_SUMMARY)
+	{
+		printf("%d teams of %d, ring %d, finish %d.\n", query->rules.teams, query->rules.teamSize, query->rules.ringSize, query->rules.finishSize);
+		printf("%-8s %12s %12s %12s\n", "Column", "Min", "Max", "Mean");
+		for (int column = 0; column < query->columnCount; column++)
+		{
+			char name[16];
+			columnName(&query->rules, column, name, sizeof(name));
+
+			// The seed has no meaningful mean and the team columns are better read with seats
+			if (column == COLUMN_FIRST_TEAM || column == COLUMN_WINNER)
+			{
+				// Teams count from 1 like in the filters, unfinished games have no winner
+				char low[16], high[16];
+				SDL_snprintf(low, sizeof(low), query->min[column] == NO_WINNER ? "none" : "%u", query->min[column] + 1);
+				SDL_snprintf(high, sizeof(high), query->max[column] == NO_WINNER ? "none" : "%u", query->max[column] + 1);
+				printf("%-8s %12s %12s %12s\n", name, low, high, "-");
+			}
+			else if (column == COLUMN_SEED)
+			{
+				printf("%-8s %12u %12u %12s\n", name, query->min[column], query->max[column], "-");
+			}
+			else
+			{
+				printf("%-8s %12u %12u %12.2f\n", name, query->min[column], query->max[column], (double)query->sums[column] / games);
+			}
+		}
+	}
+	else if (query->kind == QUERY_SEATS)
+	{
+		printf("%-6s %12s %10s    %-6s %12s %10s\n", "Seat", "Wins", "Win rate", "Team", "Wins", "Win rate");
+		for (int i = 0; i < query->rules.teams; i++)
+		{
+			printf("%-6d %12llu %9.2f%%    %-6d %12llu %9.2f%%\n", i + 1, query->seatWins[i], 100.0 * query->seatWins[i] / games,
+				i + 1, query->teamWins[i], 100.0 * query->teamWins[i] / games);
+		}
+		printf("Unfinished after %d turns: %llu (%.2f%%)\n", MAX_TURNS, query->unfinished, 100.0 * query->unfinished / games);
+	}
+	else
+	{
+		Uint64 buckets[MAX_TURNS + 1] = { 0 };
+		int bucketCount = MAX_TURNS / query->bucket + 1;
+		Uint64 largest = 1;
+		for (int turns = 0; turns <= MAX_TURNS; turns++)
+		{
+			Uint64* bucket = &buckets[turns / query->bucket];
+			*bucket += query->turnCounts[turns];
+			largest = SDL_max(largest, *bucket);
+		}
+
+		printf("%-13s %12s\n", "Turns", "Games");
+		for (int i = 0; i < bucketCount; i++)
+		{
+			if (buckets[i] == 0)
+			{
+				continue;
+			}
+
+			char bar[HISTOGRAM_WIDTH + 1];
+			int length = (int)(buckets[i] * HISTOGRAM_WIDTH / largest);
+			memset(bar, '#', length);
+			bar[length] = '\0';
+			printf("%5d - %-5d %12llu %s\n", i * query->bucket, (i + 1) * query->bucket - 1, buckets[i], bar);
+		}
+	}
+}
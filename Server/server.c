@@ -0,0 +1,740 @@
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <rules.h>
+#include <protocol.h>
+#include <feed.h>
+
+#define RECEIVE_BUFFER_SIZE 256
+
+// Spectators further behind than this miss updates until the next keyframe
+#define MAX_PENDING_SENDS 16
+// Players can't miss messages, one this far behind has stopped reading and is dropped
+#define MAX_PENDING_MESSAGES 64
+
+typedef enum { ROLL, MOVE } GamePhase;
+typedef struct IoRequest IoRequest;
+typedef struct Connection Connection;
+typedef struct Match Match;
+typedef struct FeedPacket FeedPacket;
+typedef struct SendRequest SendRequest;
+
+/*
+ * Common head of everything posted to the completion port, so completions
+ * can be cast back to the receive or send they belong to.
+ */
+struct IoRequest
+{
+	OVERLAPPED overlapped;
+	int isSend;
+};
+
+/*
+ * One client socket. Only one receive is outstanding at a time, so a
+ * connection is never handled by two workers at once. Pending feed sends
+ * hold a reference, the connection is freed when the last one completes.
+ * closing is set once the connection is being shut down, from any thread,
+ * and stops further sends and receives.
+ */
+struct Connection
+{
+	IoRequest receive;
+	SOCKET socket;
+	WSABUF buffer;
+	Uint8 data[RECEIVE_BUFFER_SIZE];
+	int received;
+	volatile LONG references;
+	volatile LONG pendingSends;
+	volatile LONG closing;
+
+	// Only changed while holding the lock of the match
+	Match* match;
+	Match* watching;
+	int seat;
+};
+
+/*
+ * One serialized feed update or message, shared by the sends to every
+ * receiver and freed when the last of them completes.
+ */
+struct FeedPacket
+{
+	volatile LONG references;
+	int size;
+	Uint8 data[FEED_UPDATE_MAX];
+};
+
+struct SendRequest
+{
+	IoRequest request;
+	Connection* connection;
+	FeedPacket* packet;
+};
+
+/*
+ * Everything the server keeps about a match. Guarded by its own lock, since
+ * the seats of a match can be served by different workers.
+ */
+struct Match
+{
+	CRITICAL_SECTION lock;
+	Position position;
+	GamePhase phase;
+	Uint32 rng;
+	int dieValue;
+	int seated;
+	int started;
+	Connection* seats[MAX_TEAMS];
+	Connection** spectators;
+	int spectatorCount;
+	int spectatorCapacity;
+	Uint16 feedSequence;
+};
+
+/* Variables */
+HANDLE completionPort;
+Rules rules;
+Match* matches;
+Uint32 matchCount = 16384;
+volatile LONG connectionCount = 0;
+volatile LONG matchesStarted = 0;
+volatile LONG matchesFinished = 0;
+volatile LONG movesPlayed = 0;
+
+/* Funcion declarations */
+int init(int port, SOCKET* listener);
+DWORD WINAPI workerThread(LPVOID data);
+DWORD WINAPI statsThread(LPVOID data);
+int postReceive(Connection* connection);
+void closeConnection(Connection* connection);
+void shutdownConnection(Connection* connection);
+void handleMessage(Connection* connection, const Message* message);
+void sendMessage(Connection* connection, MessageType type, int seat, int unit, int value);
+void broadcast(Match* match, MessageType type, int seat, int unit, int value);
+void joinMatch(Connection* connection, Uint32 id);
+void watchMatch(Connection* connection, Uint32 id);
+void finishMatch(Match* match);
+void beginMatchUpdate(Match* match, FeedUpdate* update);
+void publishUpdate(Match* match, FeedUpdate* update, int keyframe);
+void sendPacket(Connection* connection, FeedPacket* packet);
+void queueSend(Connection* connection, FeedPacket* packet);
+void completeSend(SendRequest* request);
+void releaseConnection(Connection* connection);
+
+/* Function definitions */
+int main(int argc, char* args[])
+{
+	int port = argc > 1 ? atoi(args[1]) : SERVER_PORT;
+	if (argc > 2)
+	{
+		matchCount = (Uint32)atoi(args[2]);
+	}
+
+	// Matches are played on the standard board, the protocol and clients assume it
+	setupRules(&rules, STANDARD_TEAMS, STANDARD_TEAM_SIZE, STANDARD_RING_SIZE, STANDARD_FINISH_SIZE);
+
+	SOCKET listener;
+	if (!init(port, &listener))
+	{
+		printf("Failed to initialize!\n");
+		return 1;
+	}
+
+	// A small fixed pool of workers serves every connection
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	int workerCount = (int)info.dwNumberOfProcessors;
+	for (int i = 0; i < workerCount; i++)
+	{
+		CloseHandle(CreateThread(NULL, 0, workerThread, NULL, 0, NULL));
+	}
+	CloseHandle(CreateThread(NULL, 0, statsThread, NULL, 0, NULL));
+
+	printf("Serving %u matches on port %d with %d workers.\n", matchCount, port, workerCount);
+
+	for (;;)
+	{
+		SOCKET client = accept(listener, NULL, NULL);
+		if (client == INVALID_SOCKET)
+		{
+			printf("Failed to accept connection! Winsock Error: %d\n", WSAGetLastError());
+			continue;
+		}
+
+		// Moves are tiny, send them right away
+		BOOL noDelay = TRUE;
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+		Connection* connection = (Connection*)calloc(1, sizeof(Connection));
+		connection->socket = client;
+		connection->seat = -1;
+		connection->references = 1;
+
+		if (CreateIoCompletionPort((HANDLE)client, completionPort, 0, 0) == NULL || !postReceive(connection))
+		{
+			closesocket(client);
+			free(connection);
+			continue;
+		}
+
+		InterlockedIncrement(&connectionCount);
+	}
+
+	return 0;
+}
+
+int init(int port, SOCKET* listener)
+{
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		printf("Winsock could not initialize!\n");
+		return 0;
+	}
+
+	matches = (Match*)calloc(matchCount, sizeof(Match));
+	if (matches == NULL)
+	{
+		printf("Unable to allocate %u matches!\n", matchCount);
+		return 0;
+	}
+
+	Uint32 seed = (Uint32)time(NULL);
+	for (Uint32 i = 0; i < matchCount; i++)
+	{
+		InitializeCriticalSection(&matches[i].lock);
+		matches[i].rng = (seed += 0x9E3779B9) | 1;
+	}
+
+	completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+	if (completionPort == NULL)
+	{
+		printf("Completion port could not be created! Error: %lu\n", GetLastError());
+		return 0;
+	}
+
+	*listener = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
+	if (*listener == INVALID_SOCKET)
+	{
+		printf("Socket could not be created! Winsock Error: %d\n", WSAGetLastError());
+		return 0;
+	}
+
+	struct sockaddr_in address = { 0 };
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons((u_short)port);
+
+	if (bind(*listener, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+		listen(*listener, SOMAXCONN) == SOCKET_ERROR)
+	{
+		printf("Unable to listen on port %d! Winsock Error: %d\n", port, WSAGetLastError());
+		return 0;
+	}
+
+	return 1;
+}
+
+DWORD WINAPI workerThread(LPVOID data)
+{
+	for (;;)
+	{
+		DWORD bytes = 0;
+		ULONG_PTR key;
+		OVERLAPPED* overlapped = NULL;
+		BOOL ok = GetQueuedCompletionStatus(completionPort, &bytes, &key, &overlapped, INFINITE);
+		if (overlapped == NULL)
+		{
+			// The port itself failed
+			break;
+		}
+
+		if (((IoRequest*)overlapped)->isSend)
+		{
+			completeSend((SendRequest*)overlapped);
+			continue;
+		}
+
+		Connection* connection = (Connection*)overlapped;
+		if (!ok || bytes == 0)
+		{
+			closeConnection(connection);
+			continue;
+		}
+
+		// Handle every complete message and keep the rest for the next receive
+		connection->received += bytes;
+		int offset = 0;
+		while (connection->received - offset >= MESSAGE_SIZE)
+		{
+			Message message;
+			decodeMessage(&connection->data[offset], &message);
+			handleMessage(connection, &message);
+			offset += MESSAGE_SIZE;
+		}
+
+		connection->received -= offset;
+		memmove(connection->data, &connection->data[offset], connection->received);
+
+		// A connection shut down while its messages were handled gets no new receive
+		if (connection->closing || !postReceive(connection))
+		{
+			closeConnection(connection);
+		}
+	}
+
+	return 0;
+}
+
+DWORD WINAPI statsThread(LPVOID data)
+{
+	LONG lastStarted = 0, lastFinished = 0, lastMoves = 0;
+	for (;;)
+	{
+		Sleep(1000);
+
+		LONG started = matchesStarted, finished = matchesFinished, moves = movesPlayed;
+		printf("%ld connections, %ld matches started/s, %ld matches finished/s, %ld moves/s\n",
+			connectionCount, started - lastStarted, finished - lastFinished, moves - lastMoves);
+
+		lastStarted = started;
+		lastFinished = finished;
+		lastMoves = moves;
+	}
+
+	return 0;
+}
+
+int postReceive(Connection* connection)
+{
+	DWORD flags = 0;
+	memset(&connection->receive, 0, sizeof(IoRequest));
+	connection->buffer.buf = (char*)&connection->data[connection->received];
+	connection->buffer.len = RECEIVE_BUFFER_SIZE - connection->received;
+
+	if (WSARecv(connection->socket, &connection->buffer, 1, NULL, &flags, &connection->receive.overlapped, NULL) == SOCKET_ERROR &&
+		WSAGetLastError() != WSA_IO_PENDING)
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+void closeConnection(Connection* connection)
+{
+	Match* match = connection->match;
+	if (match != NULL)
+	{
+		EnterCriticalSection(&match->lock);
+		if (connection->match == match)
+		{
+			match->seats[connection->seat] = NULL;
+			match->seated--;
+
+			// A match can't go on with an empty seat
+			if (match->started)
+			{
+				FeedUpdate update;
+				beginMatchUpdate(match, &update);
+				feedEnd(&update, 0xFF);
+				publishUpdate(match, &update, 0);
+
+				broadcast(match, MSG_ABANDONED, connection->seat, 0, 0);
+				finishMatch(match);
+			}
+		}
+		LeaveCriticalSection(&match->lock);
+	}
+
+	match = connection->watching;
+	if (match != NULL)
+	{
+		EnterCriticalSection(&match->lock);
+		for (int i = 0; i < match->spectatorCount; i++)
+		{
+			if (match->spectators[i] == connection)
+			{
+				match->spectators[i] = match->spectators[--match->spectatorCount];
+				break;
+			}
+		}
+		LeaveCriticalSection(&match->lock);
+	}
+
+	// Cancels pending feed sends, which then drop their references
+	connection->closing = 1;
+	closesocket(connection->socket);
+	InterlockedDecrement(&connectionCount);
+	releaseConnection(connection);
+}
+
+void shutdownConnection(Connection* connection)
+{
+	// Works whether or not a receive is in flight: a pending one fails, the worker inside handleMessage sees the flag
+	if (InterlockedExchange(&connection->closing, 1) == 0)
+	{
+		shutdown(connection->socket, SD_BOTH);
+	}
+}
+
+void handleMessage(Connection* connection, const Message* message)
+{
+	// Spectators only listen
+	if (connection->watching != NULL)
+	{
+		return;
+	}
+
+	if (message->type == MSG_JOIN)
+	{
+		joinMatch(connection, message->match);
+		return;
+	}
+
+	if (message->type == MSG_WATCH)
+	{
+		watchMatch(connection, message->match);
+		return;
+	}
+
+	Match* match = connection->match;
+	if (match == NULL)
+	{
+		sendMessage(connection, MSG_REJECTED, 0, 0, message->type);
+		return;
+	}
+
+	EnterCriticalSection(&match->lock);
+
+	// Only the seat whose turn it is may act, and only in a running match
+	int seat = connection->seat;
+	int valid = connection->match == match && match->started && match->position.turn == seat;
+	Position* pos = &match->position;
+	MoveResult move;
+	FeedUpdate update;
+
+	if (valid && message->type == MSG_ROLL && match->phase == ROLL)
+	{
+		match->dieValue = rollDie(&match->rng, 6);
+		match->phase = MOVE;
+		broadcast(match, MSG_ROLLED, seat, 0, match->dieValue);
+		beginMatchUpdate(match, &update);
+		feedRoll(&update, seat, match->dieValue);
+
+		// Nothing to move, the turn passes on by itself
+		int units[MAX_TEAM_SIZE];
+		if (generateMoves(&rules, pos, match->dieValue, units) == 0)
+		{
+			passTurn(&rules, pos);
+			match->phase = ROLL;
+			broadcast(match, MSG_PASSED, seat, 0, 0);
+			feedTurn(&update, pos->turn);
+		}
+
+		publishUpdate(match, &update, 0);
+	}
+	else if (valid && message->type == MSG_MOVE && match->phase == MOVE && message->unit < rules.teamSize &&
+		applyMove(&rules, pos, seat * rules.teamSize + message->unit, match->dieValue, &move))
+	{
+		match->phase = ROLL;
+		broadcast(match, MSG_MOVED, seat, message->unit, match->dieValue);
+		beginMatchUpdate(match, &update);
+		feedMove(&update, &move, pos->turn);
+		InterlockedIncrement(&movesPlayed);
+
+		if (winningTeam(&rules, pos) == seat)
+		{
+			broadcast(match, MSG_WON, seat, 0, 0);
+			feedEnd(&update, seat);
+			publishUpdate(match, &update, 0);
+			finishMatch(match);
+			InterlockedIncrement(&matchesFinished);
+		}
+		else
+		{
+			publishUpdate(match, &update, 0);
+		}
+	}
+	else if (valid && message->type == MSG_SKIP && match->phase == MOVE)
+	{
+		passTurn(&rules, pos);
+		match->phase = ROLL;
+		broadcast(match, MSG_PASSED, seat, 0, 0);
+		beginMatchUpdate(match, &update);
+		feedTurn(&update, pos->turn);
+		publishUpdate(match, &update, 0);
+	}
+	else
+	{
+		sendMessage(connection, MSG_REJECTED, seat, message->unit, message->type);
+	}
+
+	LeaveCriticalSection(&match->lock);
+}
+
+void sendMessage(Connection* connection, MessageType type, int seat, int unit, int value)
+{
+	Message message = { .type = (Uint8)type, .seat = (Uint8)seat, .unit = (Uint8)unit, .value = (Uint8)value, .match = 0 };
+	if (connection->match != NULL)
+	{
+		message.match = (Uint32)(connection->match - matches);
+	}
+
+	// Sent overlapped like the feed, workers holding a match lock never wait on a client
+	FeedPacket* packet = (FeedPacket*)malloc(sizeof(FeedPacket));
+	if (packet == NULL || connection->pendingSends >= MAX_PENDING_MESSAGES)
+	{
+		// A player missing a message would stall the match, drop the player instead
+		shutdownConnection(connection);
+		free(packet);
+		return;
+	}
+
+	packet->references = 1;
+	packet->size = MESSAGE_SIZE;
+	encodeMessage(&message, packet->data);
+	queueSend(connection, packet);
+
+	if (InterlockedDecrement(&packet->references) == 0)
+	{
+		free(packet);
+	}
+}
+
+void broadcast(Match* match, MessageType type, int seat, int unit, int value)
+{
+	for (int i = 0; i < rules.teams; i++)
+	{
+		if (match->seats[i] != NULL)
+		{
+			sendMessage(match->seats[i], type, seat, unit, value);
+		}
+	}
+}
+
+void joinMatch(Connection* connection, Uint32 id)
+{
+	// The previous match may still be finishing on another worker, its lock tells for sure
+	Match* previous = connection->match;
+	Match* current = previous;
+	if (previous != NULL)
+	{
+		EnterCriticalSection(&previous->lock);
+		current = connection->match;
+		LeaveCriticalSection(&previous->lock);
+	}
+
+	if (current != NULL || id >= matchCount)
+	{
+		sendMessage(connection, MSG_REJECTED, 0, 0, MSG_JOIN);
+		return;
+	}
+
+	Match* match = &matches[id];
+	EnterCriticalSection(&match->lock);
+
+	if (match->started || match->seated == rules.teams)
+	{
+		LeaveCriticalSection(&match->lock);
+		sendMessage(connection, MSG_REJECTED, 0, 0, MSG_JOIN);
+		return;
+	}
+
+	int seat = 0;
+	while (match->seats[seat] != NULL)
+	{
+		seat++;
+	}
+
+	match->seats[seat] = connection;
+	match->seated++;
+	connection->match = match;
+	connection->seat = seat;
+	sendMessage(connection, MSG_JOINED, seat, 0, 0);
+
+	// Start as soon as the table is full
+	if (match->seated == rules.teams)
+	{
+		resetPosition(&match->position);
+		match->position.turn = (Uint8)(nextRandom(&match->rng) % rules.teams);
+		match->phase = ROLL;
+		match->started = 1;
+		broadcast(match, MSG_START, 0, 0, match->position.turn);
+		InterlockedIncrement(&matchesStarted);
+
+		FeedUpdate update;
+		beginMatchUpdate(match, &update);
+		publishUpdate(match, &update, 1);
+	}
+
+	LeaveCriticalSection(&match->lock);
+}
+
+void finishMatch(Match* match)
+{
+	// Free the seats so the same match slot can be joined again
+	for (int i = 0; i < rules.teams; i++)
+	{
+		if (match->seats[i] != NULL)
+		{
+			match->seats[i]->match = NULL;
+			match->seats[i]->seat = -1;
+			match->seats[i] = NULL;
+		}
+	}
+
+	match->seated = 0;
+	match->started = 0;
+}
+
+void watchMatch(Connection* connection, Uint32 id)
+{
+	if (connection->match != NULL || id >= matchCount)
+	{
+		sendMessage(connection, MSG_REJECTED, 0, 0, MSG_WATCH);
+		return;
+	}
+
+	Match* match = &matches[id];
+	EnterCriticalSection(&match->lock);
+
+	if (match->spectatorCount == match->spectatorCapacity)
+	{
+		match->spectatorCapacity = match->spectatorCapacity == 0 ? 8 : match->spectatorCapacity * 2;
+		match->spectators = (Connection**)realloc(match->spectators, match->spectatorCapacity * sizeof(Connection*));
+	}
+
+	match->spectators[match->spectatorCount++] = connection;
+	connection->watching = match;
+
+	// The reply goes out first, the spectator only reads the feed after it
+	sendMessage(connection, MSG_WATCH, 0, 0, 0);
+
+	// Start the newcomer off with the full position, continuing the current sequence
+	FeedUpdate update;
+	beginFeedUpdate(&update, match->feedSequence);
+	feedKeyframe(&update, &rules, &match->position);
+
+	FeedPacket* packet = (FeedPacket*)malloc(sizeof(FeedPacket));
+	if (packet == NULL)
+	{
+		// The spectator catches up on the next regular keyframe
+		LeaveCriticalSection(&match->lock);
+		return;
+	}
+	packet->references = 1;
+	packet->size = update.size;
+	memcpy(packet->data, update.data, update.size);
+	sendPacket(connection, packet);
+	if (InterlockedDecrement(&packet->references) == 0)
+	{
+		free(packet);
+	}
+
+	LeaveCriticalSection(&match->lock);
+}
+
+void beginMatchUpdate(Match* match, FeedUpdate* update)
+{
+	beginFeedUpdate(update, ++match->feedSequence);
+}
+
+void publishUpdate(Match* match, FeedUpdate* update, int keyframe)
+{
+	if (match->spectatorCount == 0)
+	{
+		return;
+	}
+
+	// Regular keyframes let spectators that dropped updates catch up
+	if (keyframe || match->feedSequence % FEED_KEYFRAME_INTERVAL == 0)
+	{
+		prependKeyframe(update, &rules, &match->position);
+	}
+
+	// Serialize once, every spectator sends from the same packet
+	FeedPacket* packet = (FeedPacket*)malloc(sizeof(FeedPacket));
+	if (packet == NULL)
+	{
+		return;
+	}
+	packet->references = 1;
+	packet->size = update->size;
+	memcpy(packet->data, update->data, update->size);
+
+	for (int i = 0; i < match->spectatorCount; i++)
+	{
+		sendPacket(match->spectators[i], packet);
+	}
+
+	if (InterlockedDecrement(&packet->references) == 0)
+	{
+		free(packet);
+	}
+}
+
+void sendPacket(Connection* connection, FeedPacket* packet)
+{
+	if (connection->pendingSends >= MAX_PENDING_SENDS)
+	{
+		return;
+	}
+
+	queueSend(connection, packet);
+}
+
+void queueSend(Connection* connection, FeedPacket* packet)
+{
+	if (connection->closing)
+	{
+		return;
+	}
+
+	SendRequest* request = (SendRequest*)calloc(1, sizeof(SendRequest));
+	if (request == NULL)
+	{
+		shutdownConnection(connection);
+		return;
+	}
+	request->request.isSend = 1;
+	request->connection = connection;
+	request->packet = packet;
+
+	InterlockedIncrement(&packet->references);
+	InterlockedIncrement(&connection->references);
+	InterlockedIncrement(&connection->pendingSends);
+
+	WSABUF buffer = { (u_long)packet->size, (char*)packet->data };
+	if (WSASend(connection->socket, &buffer, 1, NULL, 0, &request->request.overlapped, NULL) == SOCKET_ERROR &&
+		WSAGetLastError() != WSA_IO_PENDING)
+	{
+		// No completion is coming for this one
+		completeSend(request);
+	}
+}
+
+void completeSend(SendRequest* request)
+{
+	InterlockedDecrement(&request->connection->pendingSends);
+
+	if (InterlockedDecrement(&request->packet->references) == 0)
+	{
+		free(request->packet);
+	}
+
+	releaseConnection(request->connection);
+	free(request);
+}
+
+void releaseConnection(Connection* connection)
+{
+	if (InterlockedDecrement(&connection->references) == 0)
+	{
+		free(connection);
+	}
+}
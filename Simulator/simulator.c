@@ -0,0 +1,503 @@
+#define SDL_MAIN_HANDLED
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <SDL.h>
+#include <rules.h>
+#include <evaluator.h>
+#include <simulation.h>
+#include <feed.h>
+#include <replay.h>
+#include <results.h>
+
+/* Training parameters */
+const float LEARNING_RATE = 0.01f;
+const float TRACE_DECAY = 0.7f;
+const float EXPLORATION = 0.05f;
+
+typedef struct Trainer
+{
+	const Rules* rules;
+	Weights weights;
+	int games;
+	Uint32 seed;
+	Uint64 turns;
+	int wins[MAX_TEAMS];
+} Trainer;
+
+// Games are handed out to the threads in chunks, a game takes microseconds
+#define STATS_CHUNK_GAMES 256
+// The chunk counter is a 32 bit atomic, it has to stay clear of wrapping
+#define MAX_STATS_GAMES ((Uint64)0x7FFFFFFF * STATS_CHUNK_GAMES)
+
+typedef struct StatsRun
+{
+	const Rules* rules;
+	const Weights* weights;
+	Uint32 seed;
+	Uint64 games;
+	SDL_atomic_t nextChunk;
+	FILE* file;
+	SDL_mutex* fileLock;
+	SDL_atomic_t failed;
+} StatsRun;
+
+/* Funcion declarations */
+int train(const Rules* rules, int epochs, int gamesPerEpoch, const char* path);
+int trainThread(void* data);
+void trainGame(Trainer* trainer);
+int recordGame(const Rules* rules, const char* path, const char* weightPath, Uint32 seed);
+int writeUpdate(FILE* file, FeedUpdate* update, const Rules* rules, const Position* pos);
+int collectStats(const Rules* rules, const char* path, const char* weightPath, Uint64 games);
+int statsThread(void* data);
+void playStatsGame(const Rules* rules, const Weights* weights, Uint32 seed, GameResult* result);
+
+/* Function definitions */
+int main(int argc, char* args[])
+{
+	int record = argc > 2 && strcmp(args[1], "record") == 0;
+	int stats = argc > 2 && strcmp(args[1], "stats") == 0;
+	if (!record && !stats && (argc < 2 || strcmp(args[1], "train") != 0))
+	{
+		printf("Usage: %s train [epochs] [games per epoch] [weight file] [teams] [team size] [ring size] [finish size]\n", args[0]);
+		printf("       %s record replay.bin [seed] [weight file] [teams] [team size] [ring size] [finish size]\n", args[0]);
+		printf("       %s stats results.fias [games] [weight file] [teams] [team size] [ring size] [finish size]\n", args[0]);
+		return 1;
+	}
+
+	const char* path = argc > 4 ? args[4] : "weights.bin";
+
+	// The standard board unless another variant is given
+	Rules rules;
+	if (!setupRules(&rules,
+		argc > 5 ? atoi(args[5]) : STANDARD_TEAMS,
+		argc > 6 ? atoi(args[6]) : STANDARD_TEAM_SIZE,
+		argc > 7 ? atoi(args[7]) : STANDARD_RING_SIZE,
+		argc > 8 ? atoi(args[8]) : STANDARD_FINISH_SIZE))
+	{
+		return 1;
+	}
+
+	if (record)
+	{
+		Uint32 seed = argc > 3 ? (Uint32)strtoul(args[3], NULL, 10) : (Uint32)time(NULL);
+		return recordGame(&rules, args[2], path, seed) ? 0 : 1;
+	}
+
+	if (stats)
+	{
+		Uint64 games = argc > 3 ? strtoull(args[3], NULL, 10) : 1000000;
+		if (games > MAX_STATS_GAMES)
+		{
+			printf("At most %llu games can be played in one run!\n", MAX_STATS_GAMES);
+			return 1;
+		}
+		return collectStats(&rules, args[2], path, games) ? 0 : 1;
+	}
+
+	int epochs = argc > 2 ? atoi(args[2]) : 50;
+	int gamesPerEpoch = argc > 3 ? atoi(args[3]) : 20000;
+
+	return train(&rules, epochs, gamesPerEpoch, path) ? 0 : 1;
+}
+
+int train(const Rules* rules, int epochs, int gamesPerEpoch, const char* path)
+{
+	Weights weights;
+	if (!loadWeights(&weights, path))
+	{
+		printf("Starting from the default weights.\n");
+		defaultWeights(&weights);
+	}
+
+	// One trainer per core, each playing its share of the epoch on a private copy of the weights
+	int threadCount = SDL_GetCPUCount();
+	Trainer* trainers = (Trainer*)malloc(threadCount * sizeof(Trainer));
+	SDL_Thread** threads = (SDL_Thread**)malloc(threadCount * sizeof(SDL_Thread*));
+	Uint32 seed = (Uint32)time(NULL);
+
+	printf("Training %d teams of %d on a ring of %d with %d threads.\n", rules->teams, rules->teamSize, rules->ringSize, threadCount);
+
+	for (int epoch = 0; epoch < epochs; epoch++)
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		for (int i = 0; i < threadCount; i++)
+		{
+			trainers[i] = (Trainer){ .rules = rules, .weights = weights, .games = gamesPerEpoch / threadCount, .turns = 0 };
+			memset(trainers[i].wins, 0, sizeof(trainers[i].wins));
+
+			// xorshift must never be seeded with zero
+			trainers[i].seed = (seed += 0x9E3779B9) | 1;
+			threads[i] = SDL_CreateThread(trainThread, "trainer", &trainers[i]);
+		}
+
+		Uint64 turns = 0;
+		int games = 0;
+		int wins[MAX_TEAMS] = { 0 };
+		memset(weights.w, 0, sizeof(weights.w));
+
+		// Average the weights the threads arrived at
+		for (int i = 0; i < threadCount; i++)
+		{
+			SDL_WaitThread(threads[i], NULL);
+
+			for (int j = 0; j < featureCount; j++)
+			{
+				weights.w[j] += trainers[i].weights.w[j] / threadCount;
+			}
+
+			for (int team = 0; team < rules->teams; team++)
+			{
+				wins[team] += trainers[i].wins[team];
+			}
+
+			turns += trainers[i].turns;
+			games += trainers[i].games;
+		}
+
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		printf("Epoch %d: %d games in %.2fs (%.0f games/s), %.1f turns/game, wins",
+			epoch + 1, games, seconds, games / seconds, (double)turns / games);
+		for (int team = 0; team < rules->teams; team++)
+		{
+			printf("%c%d", team == 0 ? ' ' : '/', wins[team]);
+		}
+		printf("\n");
+
+		if (!saveWeights(&weights, path))
+		{
+			free(threads);
+			free(trainers);
+			return 0;
+		}
+	}
+
+	free(threads);
+	free(trainers);
+	return 1;
+}
+
+int trainThread(void* data)
+{
+	Trainer* trainer = (Trainer*)data;
+
+	for (int i = 0; i < trainer->games; i++)
+	{
+		trainGame(trainer);
+	}
+
+	return 0;
+}
+
+/*
+ * Plays one self-play game and updates the weights with TD(lambda). Every
+ * team learns from its own perspective, so each has its own eligibility traces.
+ */
+void trainGame(Trainer* trainer)
+{
+	const Rules* rules = trainer->rules;
+	Position pos;
+	resetPosition(&pos);
+	pos.turn = (Uint8)(nextRandom(&trainer->seed) % rules->teams);
+
+	float traces[MAX_TEAMS][featureCount];
+	float features[MAX_TEAMS * featureCount];
+	float previousFeatures[MAX_TEAMS * featureCount];
+	float previousValues[MAX_TEAMS];
+	memset(traces, 0, sizeof(traces));
+
+	extractFeatures(rules, &pos, 1, previousFeatures);
+	for (int team = 0; team < rules->teams; team++)
+	{
+		previousValues[team] = evaluateFeatures(&trainer->weights, &previousFeatures[team * featureCount]);
+	}
+
+	int winner = -1;
+	int turns = 0;
+	while (winner < 0 && turns < MAX_TURNS)
+	{
+		playTurn(rules, &pos, &trainer->weights, &trainer->seed, EXPLORATION, NULL);
+		winner = winningTeam(rules, &pos);
+		turns++;
+
+		extractFeatures(rules, &pos, 1, features);
+		for (int team = 0; team < rules->teams; team++)
+		{
+			float* previous = &previousFeatures[team * featureCount];
+			float value = evaluateFeatures(&trainer->weights, &features[team * featureCount]);
+			float target = winner < 0 ? value : (winner == team ? 1.0f : 0.0f);
+			float error = target - previousValues[team];
+			float gradient = previousValues[team] * (1.0f - previousValues[team]);
+
+			for (int i = 0; i < featureCount; i++)
+			{
+				traces[team][i] = TRACE_DECAY * traces[team][i] + gradient * previous[i];
+				trainer->weights.w[i] += LEARNING_RATE * error * traces[team][i];
+			}
+
+			previousValues[team] = value;
+		}
+
+		memcpy(previousFeatures, features, rules->teams * featureCount * sizeof(float));
+	}
+
+	trainer->turns += turns;
+	if (winner >= 0)
+	{
+		trainer->wins[winner]++;
+	}
+}
+
+/*
+ * Plays one game with the evaluator in every seat and saves it as a replay,
+ * in the same updates the server sends its spectators.
+ */
+int recordGame(const Rules* rules, const char* path, const char* weightPath, Uint32 seed)
+{
+	Weights weights;
+	if (!loadWeights(&weights, weightPath))
+	{
+		printf("Playing with the default weights.\n");
+		defaultWeights(&weights);
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Unable to write replay %s!\n", path);
+		return 0;
+	}
+
+	// xorshift must never be seeded with zero
+	Uint32 rng = seed | 1;
+	Position pos;
+	resetPosition(&pos);
+	pos.turn = (Uint8)(nextRandom(&rng) % rules->teams);
+
+	Uint16 sequence = 0;
+	FeedUpdate update;
+	beginFeedUpdate(&update, sequence);
+	feedKeyframe(&update, rules, &pos);
+	int success = beginReplay(file, rules) && writeReplayUpdate(file, update.data, update.size);
+
+	int winner = -1;
+	int turns = 0;
+	while (success && winner < 0 && turns < MAX_TURNS)
+	{
+		// Like on the server the roll and the move are updates of their own
+		int team = pos.turn;
+		int dieValue = rollDie(&rng, 6);
+		int unit = chooseMove(&weights, rules, &pos, dieValue);
+
+		beginFeedUpdate(&update, ++sequence);
+		feedRoll(&update, team, dieValue);
+		if (unit < 0)
+		{
+			passTurn(rules, &pos);
+			feedTurn(&update, pos.turn);
+		}
+		success = writeUpdate(file, &update, rules, &pos);
+
+		if (success && unit >= 0)
+		{
+			MoveResult move;
+			applyMove(rules, &pos, unit, dieValue, &move);
+			winner = winningTeam(rules, &pos);
+
+			beginFeedUpdate(&update, ++sequence);
+			feedMove(&update, &move, pos.turn);
+			if (winner >= 0)
+			{
+				feedEnd(&update, winner);
+			}
+			success = writeUpdate(file, &update, rules, &pos);
+		}
+
+		turns++;
+	}
+
+	fclose(file);
+
+	if (!success)
+	{
+		printf("Unable to write replay %s!\n", path);
+	}
+	else if (winner >= 0)
+	{
+		printf("Recorded %d turns to %s, won by team %d.\n", turns, path, winner + 1);
+	}
+	else
+	{
+		printf("Recorded %d turns to %s, the game was stopped without a winner.\n", turns, path);
+	}
+
+	return success;
+}
+
+int writeUpdate(FILE* file, FeedUpdate* update, const Rules* rules, const Position* pos)
+{
+	// Keyframes at the same interval as the live feed, so a replay can be picked up anywhere
+	Uint16 sequence = (Uint16)((update->data[1] << 8) | update->data[2]);
+	if (sequence % FEED_KEYFRAME_INTERVAL == 0)
+	{
+		prependKeyframe(update, rules, pos);
+	}
+
+	return writeReplayUpdate(file, update->data, update->size);
+}
+
+/*
+ * Plays games with the evaluator in every seat and streams one row per
+ * game into a columnar results file for the Query tool.
+ */
+int collectStats(const Rules* rules, const char* path, const char* weightPath, Uint64 games)
+{
+	Weights weights;
+	if (!loadWeights(&weights, weightPath))
+	{
+		printf("Playing with the default weights.\n");
+		defaultWeights(&weights);
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL || !beginResults(file, rules))
+	{
+		printf("Unable to write results %s!\n", path);
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+		return 0;
+	}
+
+	StatsRun run = { .rules = rules, .weights = &weights, .seed = (Uint32)time(NULL), .games = games, .file = file };
+	SDL_AtomicSet(&run.nextChunk, 0);
+	SDL_AtomicSet(&run.failed, 0);
+	run.fileLock = SDL_CreateMutex();
+
+	int threadCount = SDL_GetCPUCount();
+	SDL_Thread** threads = (SDL_Thread**)malloc(threadCount * sizeof(SDL_Thread*));
+	printf("Playing %llu games of %d teams of %d on a ring of %d with %d threads.\n", games, rules->teams, rules->teamSize, rules->ringSize, threadCount);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads[i] = SDL_CreateThread(statsThread, "stats", &run);
+	}
+	for (int i = 0; i < threadCount; i++)
+	{
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	long size = ftell(file);
+	int success = fclose(file) == 0 && !SDL_AtomicGet(&run.failed);
+
+	if (success)
+	{
+		printf("Wrote %llu games to %s in %.2fs (%.0f games/s), %ld bytes, %.1f bytes/game.\n",
+			games, path, seconds, (double)games / seconds, size, games > 0 ? (double)size / games : 0.0);
+	}
+	else
+	{
+		printf("Unable to write results %s!\n", path);
+	}
+
+	free(threads);
+	SDL_DestroyMutex(run.fileLock);
+	return success;
+}
+
+int statsThread(void* data)
+{
+	StatsRun* run = (StatsRun*)data;
+	const Rules* rules = run->rules;
+
+	// Every thread fills its own block and only takes the lock to append it
+	ResultsBlock* block = (ResultsBlock*)malloc(sizeof(ResultsBlock));
+	if (block == NULL)
+	{
+		SDL_AtomicSet(&run->failed, 1);
+		return 0;
+	}
+	block->rows = 0;
+
+	int success = 1;
+	while (success)
+	{
+		Uint64 first = (Uint64)SDL_AtomicAdd(&run->nextChunk, 1) * STATS_CHUNK_GAMES;
+		if (first >= run->games)
+		{
+			break;
+		}
+
+		Uint64 last = SDL_min(first + STATS_CHUNK_GAMES, run->games);
+		for (Uint64 game = first; game < last && success; game++)
+		{
+			// Odd seeds only, recordGame sets the low bit so the seed replays the same game
+			GameResult result;
+			playStatsGame(rules, run->weights, (run->seed + (Uint32)game * 0x9E3779B9) | 1, &result);
+
+			if (addGameResult(block, rules, &result))
+			{
+				SDL_LockMutex(run->fileLock);
+				success = writeResultsBlock(run->file, rules, block);
+				SDL_UnlockMutex(run->fileLock);
+			}
+		}
+	}
+
+	SDL_LockMutex(run->fileLock);
+	success = success && writeResultsBlock(run->file, rules, block);
+	SDL_UnlockMutex(run->fileLock);
+
+	if (!success)
+	{
+		SDL_AtomicSet(&run->failed, 1);
+	}
+
+	free(block);
+	return 0;
+}
+
+/*
+ * Plays one game exactly as recordGame does, counting prods and the turns
+ * each team's units spend waiting in spawn.
+ */
+void playStatsGame(const Rules* rules, const Weights* weights, Uint32 seed, GameResult* result)
+{
+	memset(result, 0, sizeof(GameResult));
+	result->seed = seed;
+
+	Uint32 rng = seed;
+	Position pos;
+	resetPosition(&pos);
+	pos.turn = (Uint8)(nextRandom(&rng) % rules->teams);
+	result->firstTeam = pos.turn;
+
+	int winner = -1;
+	int turns = 0;
+	while (winner < 0 && turns < MAX_TURNS)
+	{
+		int team = pos.turn;
+		const Uint8* progress = &pos.progress[team * rules->teamSize];
+		for (int i = 0; i < rules->teamSize; i++)
+		{
+			result->spawnTurns[team] += progress[i] == PROGRESS_SPAWN;
+		}
+
+		MoveResult move;
+		if (playTurn(rules, &pos, weights, &rng, 0.0f, &move) && move.proddedUnit >= 0)
+		{
+			result->prods[team]++;
+		}
+
+		winner = winningTeam(rules, &pos);
+		turns++;
+	}
+
+	result->winner = winner < 0 ? NO_WINNER : (Uint8)winner;
+	result->turns = (Uint16)turns;
+}